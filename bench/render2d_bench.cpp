@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include "../include/render2d.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/**
+ * 绘制路径的 headless benchmark：不需要窗口，可以运行在 lavapipe 上
+ * 按 矩形数量 x 填充方式 x 飞行帧数 扫描，每个场景重新初始化渲染器，结果写成 JSON
+ *
+ * render2d_bench [--out render2d_bench.json] [--quick] [--device <序号|UUID>] [--filter <场景名子串>]
+ */
+
+enum class Fill {
+    Flat,          // 同一种颜色的纯色矩形 (绑定 1x1 白色纹理，与 Textured 是同一个 pipeline)
+    MixedColors,   // 每个矩形颜色不同 (实例数据不同，仍然是一次 draw)
+    Textured,      // 同一张纹理，与 Flat 的差别只是采样的纹理大小，不包含 pipeline 切换的开销
+    TextureSwitch, // 两张纹理交替，每个矩形一次 draw
+    Immediate      // DrawRectImmediate，每个矩形一次 push constant + draw
+};
+
+static const char *fillName(Fill fill) {
+    switch (fill) {
+        case Fill::Flat:
+            return "flat";
+        case Fill::MixedColors:
+            return "mixed_colors";
+        case Fill::Textured:
+            return "textured";
+        case Fill::TextureSwitch:
+            return "texture_switch";
+        case Fill::Immediate:
+            return "immediate";
+    }
+    return "unknown";
+}
+
+struct Scenario {
+    std::string name;
+    uint32_t rects;
+    Fill fill;
+    int framesInFlight;
+    uint32_t warmupFrames;
+    uint32_t frames;
+};
+
+struct Result {
+    Scenario scenario;
+    double cpuAvgUs;   // BeginFrame 返回到 EndFrame 返回：记录 + 提交，不含等待飞行帧
+    double cpuP50Us;
+    double cpuP99Us;
+    double gpuAvgUs;   // GPU "frame" 区间，不支持时间戳时为 0
+    double gpuP99Us;
+    double frameUs;    // 包含等待在内的平均帧间隔
+    double rectsPerSec; // 每秒提交的矩形数
+    uint32_t drawCallsPerFrame; // 每帧实际录制的 draw call 数
+    uint64_t gpuPeakUsedBytes;
+    uint64_t gpuReservedBytes;
+    uint64_t hostPeakRssBytes; // 进程级峰值，随场景单调不减
+};
+
+constexpr int kWidth = 1280;
+constexpr int kHeight = 720;
+
+// 每个场景大约提交的矩形总数，矩形越多帧数越少
+constexpr uint64_t kRectBudget = 2000000;
+
+static uint64_t hostPeakRss() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+static std::vector<Scenario> buildScenarios(bool quick, const std::string &filter) {
+    std::vector<uint32_t> rectCounts = quick ? std::vector<uint32_t>{1, 1000, 100000}
+                                             : std::vector<uint32_t>{1, 100, 10000, 100000, 1000000};
+    std::vector<int> flightCounts = quick ? std::vector<int>{2} : std::vector<int>{1, 2, 3};
+    std::vector<Fill> fills{Fill::Flat, Fill::MixedColors, Fill::Textured, Fill::TextureSwitch, Fill::Immediate};
+
+    std::vector<Scenario> scenarios;
+    for (auto framesInFlight: flightCounts) {
+        for (auto fill: fills) {
+            for (auto rects: rectCounts) {
+                // 每个矩形一次 draw 的场景超过 10 万次 draw 没有参考意义
+                if ((fill == Fill::TextureSwitch || fill == Fill::Immediate) && rects > 100000) {
+                    continue;
+                }
+                Scenario scenario;
+                scenario.name = std::string(fillName(fill)) + "/" + std::to_string(rects) + "/fif" +
+                                std::to_string(framesInFlight);
+                if (!filter.empty() && scenario.name.find(filter) == std::string::npos) {
+                    continue;
+                }
+                scenario.rects = rects;
+                scenario.fill = fill;
+                scenario.framesInFlight = framesInFlight;
+                scenario.warmupFrames = framesInFlight + 2;
+                scenario.frames = static_cast<uint32_t>(std::clamp<uint64_t>(kRectBudget / rects, 10, 200));
+                scenarios.push_back(scenario);
+            }
+        }
+    }
+    return scenarios;
+}
+
+// 8x8 棋盘格，两种颜色用来区分两张纹理
+static std::unique_ptr<render_2d::Texture> createCheckerTexture(uint32_t colorA, uint32_t colorB) {
+    constexpr uint32_t size = 8;
+    std::vector<uint32_t> pixels(size * size);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            pixels[y * size + x] = ((x + y) & 1) ? colorA : colorB;
+        }
+    }
+    return std::make_unique<render_2d::Texture>(size, size, pixels.data(), VK_FILTER_NEAREST);
+}
+
+static void drawScene(render_2d::Renderer &renderer, const Scenario &scenario,
+                      const std::array<std::unique_ptr<render_2d::Texture>, 2> &textures) {
+    static const render_2d::Color palette[] = {
+            {1.0f, 0.0f, 0.0f, 1.0f},
+            {0.0f, 1.0f, 0.0f, 1.0f},
+            {0.0f, 0.0f, 1.0f, 1.0f},
+            {1.0f, 1.0f, 0.0f, 1.0f},
+            {1.0f, 0.0f, 1.0f, 1.0f},
+            {0.0f, 1.0f, 1.0f, 1.0f},
+            {0.5f, 0.5f, 0.5f, 1.0f},
+            {0.0f, 0.0f, 0.0f, 1.0f}
+    };
+    renderer.SetDrawColor(palette[0]);
+    for (uint32_t i = 0; i < scenario.rects; i++) {
+        // 固定的伪随机分布，铺满整个画面
+        render_2d::Rect rect{glm::vec2((i * 7919u) % kWidth, (i * 104729u) % kHeight), glm::vec2(16, 16)};
+        switch (scenario.fill) {
+            case Fill::Flat:
+                renderer.DrawRect(rect);
+                break;
+            case Fill::MixedColors:
+                renderer.SetDrawColor(palette[i % 8]);
+                renderer.DrawRect(rect);
+                break;
+            case Fill::Textured:
+                renderer.DrawTexturedRect(rect, *textures[0]);
+                break;
+            case Fill::TextureSwitch:
+                renderer.DrawTexturedRect(rect, *textures[i & 1]);
+                break;
+            case Fill::Immediate:
+                renderer.DrawRectImmediate(rect, palette[i % 8]);
+                break;
+        }
+    }
+}
+
+static std::string deviceName() {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(render_2d::Context::GetInstance().physicalDevice_, &properties);
+    return properties.deviceName;
+}
+
+static Result runScenario(const Scenario &scenario, std::string &device) {
+    render_2d::InitHeadless({}, kWidth, kHeight, scenario.framesInFlight);
+    device = deviceName();
+    auto &renderer = *render_2d::GetRenderer();
+    std::array<std::unique_ptr<render_2d::Texture>, 2> textures{
+            createCheckerTexture(0xffffffff, 0xff808080),
+            createCheckerTexture(0xff0000ff, 0xffff0000)
+    };
+
+    for (uint32_t i = 0; i < scenario.warmupFrames; i++) {
+        renderer.BeginFrame();
+        drawScene(renderer, scenario, textures);
+        renderer.EndFrame();
+    }
+    renderer.GetGpuProfiler().ResetStats();
+
+    render_2d::FrameStats cpuTimes(scenario.frames);
+    double cpuTotalMs = 0.0;
+    uint32_t drawCalls = 0; // 每帧的场景相同，取最后一帧
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < scenario.frames; i++) {
+        renderer.BeginFrame();
+        auto recordStart = std::chrono::steady_clock::now();
+        drawScene(renderer, scenario, textures);
+        renderer.EndFrame();
+        drawCalls = renderer.GetDrawCallCount();
+        auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+        cpuTimes.AddFrame(ms);
+        cpuTotalMs += ms;
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Result result{};
+    result.scenario = scenario;
+    auto cpu = cpuTimes.GetPercentiles();
+    result.cpuAvgUs = cpuTotalMs * 1000.0 / scenario.frames;
+    result.cpuP50Us = cpu.p50Ms * 1000.0;
+    result.cpuP99Us = cpu.p99Ms * 1000.0;
+    auto gpuStats = renderer.GetGpuProfiler().GetStats();
+    auto gpuFrame = gpuStats.find("frame");
+    if (gpuFrame != gpuStats.end()) {
+        result.gpuAvgUs = gpuFrame->second.avgMs * 1000.0;
+        result.gpuP99Us = gpuFrame->second.p99Ms * 1000.0;
+    }
+    result.frameUs = seconds * 1e6 / scenario.frames;
+    result.rectsPerSec = static_cast<double>(scenario.rects) * scenario.frames / seconds;
+    result.drawCallsPerFrame = drawCalls;
+
+    // 纹理在 Quit 之前释放，析构时交给 DeletionQueue
+    for (auto &texture: textures) {
+        texture.reset();
+    }
+    auto memory = render_2d::Context::GetInstance().memoryAllocator_->GetStats();
+    result.gpuPeakUsedBytes = memory.peakUsedBytes;
+    result.gpuReservedBytes = memory.reservedBytes;
+    render_2d::Quit();
+    result.hostPeakRssBytes = hostPeakRss();
+    return result;
+}
+
+static std::string escapeJson(const std::string &text) {
+    std::string escaped;
+    for (auto c: text) {
+        if (c == '"' || c == '\\') {
+            escaped.push_back('\\');
+        }
+        escaped.push_back(c);
+    }
+    return escaped;
+}
+
+static bool writeJson(const std::string &path, const std::string &device, const std::vector<Result> &results) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        std::cerr << "render2d_bench failed to open " << path << std::endl;
+        return false;
+    }
+    file << std::fixed << std::setprecision(3);
+    file << "{\n\"device\":\"" << escapeJson(device) << "\",\n\"width\":" << kWidth << ",\"height\":" << kHeight
+         << ",\n\"scenarios\":[";
+    bool first = true;
+    for (auto &result: results) {
+        auto &scenario = result.scenario;
+        file << (first ? "" : ",") << "\n{\"name\":\"" << scenario.name << "\",\"rects\":" << scenario.rects
+             << ",\"fill\":\"" << fillName(scenario.fill) << "\",\"frames_in_flight\":" << scenario.framesInFlight
+             << ",\"frames\":" << scenario.frames
+             << ",\"cpu_us_per_frame\":" << result.cpuAvgUs << ",\"cpu_p50_us\":" << result.cpuP50Us
+             << ",\"cpu_p99_us\":" << result.cpuP99Us
+             << ",\"gpu_us_per_frame\":" << result.gpuAvgUs << ",\"gpu_p99_us\":" << result.gpuP99Us
+             << ",\"frame_us\":" << result.frameUs << ",\"rects_per_sec\":" << result.rectsPerSec
+             << ",\"draw_calls_per_frame\":" << result.drawCallsPerFrame
+             << ",\"gpu_peak_used_bytes\":" << result.gpuPeakUsedBytes
+             << ",\"gpu_reserved_bytes\":" << result.gpuReservedBytes
+             << ",\"host_peak_rss_bytes\":" << result.hostPeakRssBytes << "}";
+        first = false;
+    }
+    file << "\n]\n}\n";
+    return static_cast<bool>(file);
+}
+
+int main(int argc, char **argv) {
+    std::string outPath = "render2d_bench.json";
+    std::string filter;
+    bool quick = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--device" && i + 1 < argc) {
+            render_2d::SetPreferredDevice(argv[++i]);
+        } else if (arg == "--quick") {
+            quick = true;
+        } else {
+            std::cerr << "usage: render2d_bench [--out file.json] [--quick] [--device index|uuid] [--filter name]"
+                      << std::endl;
+            return 2;
+        }
+    }
+
+    auto scenarios = buildScenarios(quick, filter);
+    if (scenarios.empty()) {
+        std::cerr << "render2d_bench: no scenario matches " << filter << std::endl;
+        return 2;
+    }
+
+    std::vector<Result> results;
+    std::string device;
+    try {
+        for (auto &scenario: scenarios) {
+            auto result = runScenario(scenario, device);
+            results.push_back(result);
+            // 结果行写到 cerr，与初始化时 cout 上的日志分开
+            std::cerr << std::fixed << std::setprecision(1) << std::left << std::setw(28) << scenario.name
+                      << " cpu " << result.cpuAvgUs << " us  gpu " << result.gpuAvgUs << " us  "
+                      << std::setprecision(0) << result.rectsPerSec << " rects/s  " << result.drawCallsPerFrame
+                      << " draws/frame" << std::endl;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "render2d_bench failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return writeJson(outPath, device, results) ? 0 : 1;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "tool.h"
+#include "memory_allocator.h"
 
 namespace render_2d {
     class Buffer final {
@@ -8,35 +9,46 @@ namespace render_2d {
     public:
         VkBuffer buffer_;
 
-        VkDeviceMemory memory_;
+        // 从 MemoryAllocator 子分配的内存 (VkDeviceMemory + offset)，多个 Buffer 共享同一个 VkDeviceMemory
+        MemoryAllocator::Allocation allocation_;
 
         uint64_t buffer_size_;
 
-        Buffer(uint64_t buffer_size, VkBufferUsageFlags bufferUsage, VkMemoryPropertyFlags property,
-               VkDevice device, VkPhysicalDevice gpu);
+        // 最近一次访问该 buffer 的提交在图像队列时间线上的值，0 表示 GPU 还没有访问过
+        // 由 Renderer (绘制) 和 UploadManager (拷贝) 记录，传输队列整块覆盖前只等待这个值
+        uint64_t lastGraphicsUse_ = 0;
+
+        // queueFamilies 多于一个时使用 CONCURRENT 共享模式，多个队列族可以直接访问而不需要所有权转移
+        Buffer(uint64_t buffer_size, VkBufferUsageFlags bufferUsage, const MemoryPreference &preference,
+               VkDevice device, const std::vector<uint32_t> &queueFamilies = {});
 
         ~Buffer();
 
+        // 非 HOST_COHERENT 内存: CPU 写完后 Flush，CPU 读取前 Invalidate (coherent 内存为空操作)
+        void Flush();
+
+        void Invalidate();
+
         void *map; // 如果host可见，使用 map 进行数据操作
     private:
         // 查询内存信息 用于内存分配指定内存索引
         struct MemoryInfo {
-            size_t size;
+            VkMemoryRequirements requirements;
             uint32_t index;
         };
 
-        void createBuffer(uint64_t size, VkBufferUsageFlags bufferUsage);
+        void createBuffer(uint64_t size, VkBufferUsageFlags bufferUsage, const std::vector<uint32_t> &queueFamilies);
 
         void allocateMemory(MemoryInfo info);
 
         void bindingMemory();
 
-        MemoryInfo queryMemoryInfo(VkBuffer buffer, VkMemoryPropertyFlags property);
+        MemoryInfo queryMemoryInfo(VkBuffer buffer, const MemoryPreference &preference);
 
     private:
         VkDevice device_;
 
-        VkPhysicalDevice gpu_;
+        bool coherent_;
     };
 
-}
\ No newline at end of file
+}
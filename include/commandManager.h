@@ -17,10 +17,51 @@ namespace render_2d {
 
         void FreeCmdBuffer(VkCommandBuffer cmdBuffer);
 
+        /**
+         * 每个 frame-in-flight 一个 transient command pool，主 commandBuffer 从中按顺序取用
+         * 该帧 fence 签发后由 ResetFrame 整体重置，避免逐个 reset / free commandBuffer
+         */
+        void InitFramePools(uint32_t frameCount);
+
+        // 从该帧的 pool 中取一个 primary commandBuffer，直到下一次 ResetFrame 前有效
+        VkCommandBuffer AllocatePrimary(uint32_t frame);
+
+        /**
+         * 多线程录制：每一帧、每个录制线程一个 transient command pool
+         * VkCommandPool 不能被多个线程同时使用，同一个 pool 只会被对应线程访问
+         */
+        void InitThreadPools(uint32_t frameCount, uint32_t threadCount);
+
+        // 从 [frame][thread] 的 pool 中取一个 secondary commandBuffer，只能在对应线程中调用
+        VkCommandBuffer AllocateSecondary(uint32_t frame, uint32_t thread);
+
+        // 该帧 fence 签发之后调用，整体重置该帧的 pool 以及所有线程的 pool，commandBuffer 回收复用
+        void ResetFrame(uint32_t frame);
+
     private:
+        struct FramePool {
+            VkCommandPool pool;
+            std::vector<VkCommandBuffer> primaries;
+            size_t usedPrimaries = 0;
+            std::vector<VkCommandBuffer> secondaries;
+            size_t usedSecondaries = 0;
+        };
+
         VkCommandPool pool_;
 
-        VkCommandPool createCommandPool();
+        std::vector<FramePool> framePools_; // [frame]
+
+        std::vector<std::vector<FramePool>> threadPools_; // [frame][thread]
+
+        VkCommandPool createCommandPool(VkCommandPoolCreateFlags flags);
+
+        VkCommandBuffer acquire(FramePool &framePool, VkCommandBufferLevel level);
+
+        void reset(FramePool &framePool);
+
+        void destroyPools(std::vector<FramePool> &framePools);
+
+        void destroyThreadPools();
 
         std::vector<VkCommandBuffer> commandBuffers_;
 
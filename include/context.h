@@ -8,14 +8,29 @@
 #include "tool.h"
 #include "swapchain.h"
 #include "commandManager.h"
+#include "upload_manager.h"
+#include "memory_allocator.h"
+#include "pipeline_cache.h"
+#include "sampler_cache.h"
+#include "descriptor_allocator.h"
+#include "layout_cache.h"
+#include "timeline.h"
+#include "deletion_queue.h"
 
 namespace render_2d {
     class Context final {
     public:
+        // func 为空时为 headless 模式：不创建 surface、present 队列和交换链，渲染到离屏图像
         static void Init(const std::vector<const char *> &extensions, CreateSurfaceFunc func);
 
         static void Quit();
 
+        /**
+         * 指定使用的物理设备 (Init 之前调用)：设备序号 ("1") 或 deviceUUID (十六进制，可带 '-')
+         * 未设置时读取环境变量 RENDER2D_DEVICE，都没有时按评分自动选择
+         */
+        static void SetDeviceOverride(const std::string &device);
+
         static Context &GetInstance() {
             assert(context_instance_);
             return *context_instance_;
@@ -28,6 +43,8 @@ namespace render_2d {
             std::optional<uint32_t> graphicsQueue;
             // 显示命令队列
             std::optional<uint32_t> presentQueue;
+            // 只支持传输的队列族 (通常对应独立的 DMA 引擎)，没有时所有拷贝都在图像队列上执行
+            std::optional<uint32_t> transferQueue;
 
             operator bool() const {
                 return graphicsQueue.has_value() && presentQueue.has_value();
@@ -36,18 +53,36 @@ namespace render_2d {
 
         VkInstance instance_;
         VkPhysicalDevice physicalDevice_;
+        VkPhysicalDeviceMemoryProperties memoryProperties_; // 选中物理设备后查询一次并缓存
         VkDevice device_;
         VkQueue graphicsQueue_;
         VkQueue presentQueue_;
+        VkQueue transferQueue_; // 没有独立的传输队列族时为 VK_NULL_HANDLE
         QueueFamilyIndices queueFamilyIndices_;
         VkSurfaceKHR surface_;
         std::shared_ptr<SwapChain> swapchain_;
         std::shared_ptr<RenderProcess> render_process_;
         std::shared_ptr<CommandManager> commandManager_;
         std::shared_ptr<Shader> shader_;
+        std::shared_ptr<UploadManager> uploadManager_;
+        std::shared_ptr<MemoryAllocator> memoryAllocator_;
+        std::shared_ptr<PipelineCache> pipelineCache_;
+        std::shared_ptr<SamplerCache> samplerCache_;
+        std::shared_ptr<DescriptorAllocator> textureDescriptors_; // 纹理 set = 1 的 combined image sampler 描述符集
+        std::shared_ptr<LayoutCache> layoutCache_; // 按内容去重的描述符集布局 / pipeline layout
+        std::shared_ptr<Timeline> timeline_; // 图像队列的时间线，所有向 graphicsQueue_ 的提交都 signal 它
+        std::shared_ptr<Timeline> transferTimeline_; // 传输队列的时间线，没有传输队列时为空
+        std::shared_ptr<DeletionQueue> deletionQueue_; // Buffer / Texture 析构时交给它，GPU 用完后再释放
 
         void InitSwapChain(int width, int height);
 
+        // headless 模式下用 imageCount 个离屏颜色图像代替交换链图像
+        void InitOffscreenSwapChain(int width, int height, uint32_t imageCount);
+
+        bool IsHeadless() const {
+            return surface_ == VK_NULL_HANDLE;
+        }
+
         void InitRenderProcess();
 
         void InitCommandManager();
@@ -56,21 +91,32 @@ namespace render_2d {
 
         void QuitCommandManager();
 
+        void InitUploadManager();
+
+        void QuitUploadManager();
+
         void InitShaderModules();
 
         void QuitShaderModules();
 
+        // 在 memoryTypeBits 允许的类型中选择满足 required、preferred 最多、avoid 最少的内存类型
+        std::optional<uint32_t> FindMemoryType(uint32_t memoryTypeBits, const MemoryPreference &preference) const;
+
     private:
         Context(const std::vector<const char *> &extensions, CreateSurfaceFunc func);
 
         static std::unique_ptr<Context> context_instance_;
 
+        static std::string deviceOverride_;
+
         void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
 
         void createInstance(const std::vector<const char *> &extensions);
 
         void pickPhysicalDevice();
 
+        std::optional<uint64_t> rateDevice(VkPhysicalDevice device, const VkPhysicalDeviceProperties &properties);
+
         void getQueues();
 
         void createDevice();
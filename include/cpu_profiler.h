@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include "tool.h"
+
+/**
+ * CPU 区间计时：RENDER2D_PROFILE_SCOPE("name") 记录所在作用域的耗时，name 必须是字符串字面量
+ * 未定义 RENDER2D_ENABLE_PROFILING (CMake 选项) 时宏展开为空语句，没有任何开销
+ */
+#ifdef RENDER2D_ENABLE_PROFILING
+#define RENDER2D_PROFILE_CONCAT_IMPL(a, b) a##b
+#define RENDER2D_PROFILE_CONCAT(a, b) RENDER2D_PROFILE_CONCAT_IMPL(a, b)
+#define RENDER2D_PROFILE_SCOPE(name) ::render_2d::CpuScope RENDER2D_PROFILE_CONCAT(cpuScope_, __LINE__)(name)
+#else
+#define RENDER2D_PROFILE_SCOPE(name) ((void) 0)
+#endif
+
+namespace render_2d {
+    /**
+     * 每个线程一个固定大小的环形事件 buffer，只有所属线程写入 (单生产者，不加锁)，
+     * 写满后覆盖最旧的事件；导出时读取每个线程最近的 kThreadCapacity 个事件
+     */
+    class CpuProfiler final {
+    public:
+        static constexpr size_t kThreadCapacity = 8192;
+
+        static uint64_t NowNs() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        static void Record(const char *name, uint64_t startNs, uint64_t endNs);
+
+        /**
+         * 写出所有线程的事件 (Chrome trace / Perfetto JSON)
+         * 与写入线程并发导出时，正在被覆盖的少量事件可能不完整，仅用于诊断
+         */
+        static bool WriteChromeTrace(const std::string &path);
+    };
+
+    class CpuScope final {
+    public:
+        explicit CpuScope(const char *name) : name_(name), startNs_(CpuProfiler::NowNs()) {}
+
+        ~CpuScope() {
+            CpuProfiler::Record(name_, startNs_, CpuProfiler::NowNs());
+        }
+
+        CpuScope(const CpuScope &) = delete;
+
+        CpuScope &operator=(const CpuScope &) = delete;
+
+    private:
+        const char *name_;
+        uint64_t startNs_;
+    };
+
+    // 最近 windowSize 帧的帧时间分布
+    class FrameStats final {
+    public:
+        struct Percentiles {
+            double p50Ms;
+            double p95Ms;
+            double p99Ms;
+            double maxMs;
+            size_t samples;
+        };
+
+        explicit FrameStats(size_t windowSize = 1000) : windowSize_(windowSize) {}
+
+        void AddFrame(double ms);
+
+        Percentiles GetPercentiles() const;
+
+    private:
+        size_t windowSize_;
+
+        std::deque<double> frames_;
+    };
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <mutex>
+#include "tool.h"
+#include "timeline.h"
+
+namespace render_2d {
+    /**
+     * 延迟销毁队列：销毁请求带上资源最后一次被使用时的时间线值，该值完成后才真正释放，不需要让GPU空闲
+     * 不带值的请求对应的资源可能还会被正在录制的帧使用，先挂起，由该帧提交后的 Seal 统一打上提交的值
+     */
+    class DeletionQueue final {
+    public:
+        using Deleter = std::function<void()>;
+
+        explicit DeletionQueue(std::shared_ptr<Timeline> timeline);
+
+        // 等待所有请求对应的提交完成并全部释放
+        ~DeletionQueue();
+
+        // 资源最后一次使用的时间线值未知 (可能在当前帧中)，等到下一次 Seal
+        void Push(Deleter deleter);
+
+        // 资源最后一次被时间线值 value 的提交使用
+        void Push(uint64_t value, Deleter deleter);
+
+        /**
+         * 资源在之后第 frames 次 Seal 的提交完成后释放
+         * 用于 present 引擎使用的资源 (旧交换链 / present 等待的信号量)：present 没有时间线值可查，只能按帧数推迟
+         */
+        void PushAfterFrames(uint32_t frames, Deleter deleter);
+
+        // 一帧提交之后调用，挂起的请求在 value 完成后释放
+        void Seal(uint64_t value);
+
+        // 释放所有已完成的请求，不阻塞
+        void Collect();
+
+    private:
+        struct Entry {
+            uint64_t value;
+            Deleter deleter;
+        };
+
+        std::shared_ptr<Timeline> timeline_;
+
+        std::vector<Entry> entries_;
+
+        std::vector<Deleter> unsealed_;
+
+        struct Delayed {
+            uint32_t frames; // 还需要经过的 Seal 次数
+            Deleter deleter;
+        };
+
+        std::vector<Delayed> delayed_;
+
+        std::mutex mutex_; // 资源可能在其它线程中析构
+    };
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+#include "tool.h"
+
+namespace render_2d {
+    /**
+     * 共享、可增长的描述符集分配器：内部维护一组带 FREE_DESCRIPTOR_SET_BIT 的 VkDescriptorPool，
+     * 现有的池都分配不出时再创建一个容量翻倍的新池，描述符集释放后回到原来的池中复用
+     * 由 Context 持有，所有池在 Context 销毁时统一释放
+     */
+    class DescriptorAllocator final {
+    public:
+        struct Allocation {
+            VkDescriptorPool pool;
+            VkDescriptorSet set;
+        };
+
+        /**
+         * setSizes 为每个描述符集需要的各类描述符数量，新池按 setSizes * maxSets 设置容量
+         * initialSets 为第一个池的 maxSets
+         */
+        DescriptorAllocator(VkDevice device, std::vector<VkDescriptorPoolSize> setSizes, uint32_t initialSets);
+
+        ~DescriptorAllocator();
+
+        // 失败时抛出 std::runtime_error
+        Allocation Allocate(VkDescriptorSetLayout layout);
+
+        // 必须在使用该描述符集的帧执行完之后调用
+        void Free(const Allocation &allocation);
+
+    private:
+        struct Pool {
+            VkDescriptorPool pool;
+            uint32_t maxSets;
+            uint32_t allocated;
+        };
+
+        Pool &createPool();
+
+        std::vector<VkDescriptorPoolSize> setSizes_;
+
+        uint32_t initialSets_;
+
+        std::vector<Pool> pools_;
+
+        std::mutex mutex_;
+
+        VkDevice device_;
+    };
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <unordered_map>
+#include "tool.h"
+#include "texture_atlas.h"
+#include "../stb_image/stb_truetype.h"
+
+namespace render_2d {
+    /**
+     * TrueType 字体和字形缓存
+     * 字形在第一次使用时用 stb_truetype 按 rasterHeight 光栅化，打包进字体自己的图集页中，
+     * 绘制时按目标字号缩放，同一页上的字形合并为一次实例化 draw
+     * 排版结果 (字形位置、uv) 按字符串缓存，重复绘制相同文本时不再逐字计算
+     */
+    class Font final {
+    public:
+        // 排版后的一个字形四边形，坐标以 rasterHeight 像素为单位，原点为第一行基线的起点
+        struct GlyphQuad {
+            glm::vec2 offset; // 左上角
+            glm::vec2 size;
+            const Texture *texture;
+            glm::vec4 uvRect;
+        };
+
+        struct TextLayout {
+            std::vector<GlyphQuad> quads;
+            glm::vec2 size; // 包围盒大小 (宽为最长一行)
+        };
+
+        explicit Font(const std::string &path, float rasterHeight = 32.0f);
+
+        ~Font();
+
+        // 排版 UTF-8 字符串，支持 '\n' 换行，结果会被缓存
+        const TextLayout &Layout(const std::string &text);
+
+        float GetRasterHeight() const { return rasterHeight_; }
+
+        // 基线到文本顶部的距离 (rasterHeight 像素)
+        float GetAscent() const { return ascent_; }
+
+        float GetLineHeight() const { return lineHeight_; }
+
+    private:
+        struct Glyph {
+            std::optional<AtlasRegion> region; // 空白字符没有位图
+            glm::vec2 bearing; // 位图左上角相对于基线起点的偏移
+            float advance;
+        };
+
+        const Glyph &getGlyph(uint32_t codepoint);
+
+        std::string data_; // stbtt_fontinfo 直接引用字体文件数据
+
+        stbtt_fontinfo info_;
+
+        float rasterHeight_;
+
+        float scale_;
+
+        float ascent_;
+
+        float lineHeight_;
+
+        TextureAtlas atlas_;
+
+        std::unordered_map<uint32_t, Glyph> glyphs_;
+
+        std::unordered_map<std::string, TextLayout> layouts_;
+    };
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <string>
+#include "tool.h"
+
+namespace render_2d {
+    /**
+     * GPU 时间戳 profiler
+     * 每帧一个 VkQueryPool，命名区间的首尾各写一个 vkCmdWriteTimestamp；
+     * 结果在该帧下一次 BeginFrame (frameCount 帧之后，上一次提交已完成) 时取回，不会阻塞 CPU 或 GPU。
+     * 同名区间在一帧内的耗时累加，按最近 kWindowFrames 帧统计 min / avg / p99。
+     * 只能在录制主 commandBuffer 的线程中使用，不能在 secondary commandBuffer 中写区间。
+     */
+    class GpuProfiler final {
+    public:
+        static constexpr uint32_t kMaxScopes = 128; // 每帧最多的区间数
+
+        static constexpr size_t kWindowFrames = 240; // 统计和 trace 保留的帧数
+
+        struct Stats {
+            double lastMs;
+            double minMs;
+            double avgMs;
+            double p99Ms;
+            size_t samples;
+        };
+
+        // 队列族不支持时间戳 (timestampValidBits 为 0) 时不记录任何区间
+        GpuProfiler(uint32_t frameCount, uint32_t queueFamilyIndex, VkPhysicalDevice physicalDevice, VkDevice device);
+
+        ~GpuProfiler();
+
+        // 该帧上一次提交完成之后调用：取回该帧上一次的结果，开始记录新的一帧
+        void BeginFrame(uint32_t frame);
+
+        // 返回区间编号，未启用或超出容量时返回 -1 (End 忽略 -1)
+        int Begin(VkCommandBuffer cmd, const std::string &name);
+
+        void End(VkCommandBuffer cmd, int scope);
+
+        void SetEnabled(bool enabled) {
+            enabled_ = enabled;
+        }
+
+        bool IsEnabled() const {
+            return enabled_ && supported_;
+        }
+
+        // 每个区间名最近 kWindowFrames 帧的耗时统计
+        std::map<std::string, Stats> GetStats() const;
+
+        // 丢弃已经取回的统计和 trace (例如预热之后)，还在执行中的帧之后照常取回
+        void ResetStats();
+
+        // 最近 kWindowFrames 帧的所有区间写成 Chrome trace JSON (chrome://tracing / Perfetto)
+        bool WriteChromeTrace(const std::string &path) const;
+
+    private:
+        struct Scope {
+            std::string name;
+            uint32_t beginQuery;
+        };
+
+        struct FrameQueries {
+            VkQueryPool pool;
+            std::vector<Scope> scopes;
+            bool needsReset;
+            uint64_t frameIndex;
+        };
+
+        struct TraceEvent {
+            std::string name;
+            uint64_t frameIndex;
+            double startUs;
+            double durationUs;
+        };
+
+        void collect(FrameQueries &frame);
+
+        VkDevice device_;
+
+        std::vector<FrameQueries> frames_;
+
+        FrameQueries *current_ = nullptr;
+
+        double periodNs_; // 一个时间戳单位对应的纳秒数
+
+        uint64_t validMask_;
+
+        bool supported_;
+
+        bool enabled_ = true;
+
+        uint64_t frameCounter_ = 0;
+
+        std::map<std::string, std::deque<double>> history_; // 每个区间名最近若干帧的耗时 (ms)
+
+        std::deque<TraceEvent> trace_;
+    };
+}
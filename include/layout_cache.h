@@ -0,0 +1,49 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include "tool.h"
+#include "shader_reflection.h"
+
+namespace render_2d {
+    /**
+     * VkDescriptorSetLayout / VkPipelineLayout 缓存，以布局内容的哈希查找
+     * 内容相同的布局只创建一次，不同 shader 得到同一个句柄，pipeline layout 天然兼容，切换 pipeline 时不需要重新绑定
+     * 由 Context 持有，所有布局在 Context 销毁时统一释放
+     */
+    class LayoutCache final {
+    public:
+        struct PipelineLayout {
+            VkPipelineLayout layout;
+            std::vector<VkDescriptorSetLayout> setLayouts; // 下标为 set 编号
+        };
+
+        explicit LayoutCache(VkDevice device);
+
+        ~LayoutCache();
+
+        // bindings 中的 pImmutableSamplers 不参与比较，必须为空
+        VkDescriptorSetLayout GetSetLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings);
+
+        VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout> &setLayouts,
+                                           const std::vector<VkPushConstantRange> &pushConstants);
+
+        // 按反射结果创建 (或取得) 每个 set 的布局和 pipeline layout
+        PipelineLayout Get(const ShaderReflection &reflection);
+
+    private:
+        using Key = std::vector<uint64_t>;
+
+        struct KeyHash {
+            size_t operator()(const Key &key) const;
+        };
+
+        std::unordered_map<Key, VkDescriptorSetLayout, KeyHash> setLayouts_;
+
+        std::unordered_map<Key, VkPipelineLayout, KeyHash> pipelineLayouts_;
+
+        std::mutex mutex_;
+
+        VkDevice device_;
+    };
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <mutex>
+#include <set>
+#include "tool.h"
+
+namespace render_2d {
+    /**
+     * 内存类型选择偏好: required 必须全部满足，preferred 尽量满足，avoid 尽量避开
+     * 例如流式数据优先 DEVICE_LOCAL|HOST_VISIBLE (ReBAR)，回读优先 HOST_CACHED
+     */
+    struct MemoryPreference {
+        VkMemoryPropertyFlags required;
+        VkMemoryPropertyFlags preferred;
+        VkMemoryPropertyFlags avoid;
+
+        MemoryPreference(VkMemoryPropertyFlags required = 0, VkMemoryPropertyFlags preferred = 0,
+                         VkMemoryPropertyFlags avoid = 0) : required(required), preferred(preferred), avoid(avoid) {}
+
+        // 只有GPU访问，避开 host可见类型，把 BAR 留给流式数据
+        static MemoryPreference GpuOnly();
+
+        // CPU每帧写入、GPU读取 (实例流/uniform)
+        static MemoryPreference Streaming();
+
+        // CPU写入、作为拷贝源 (staging)
+        static MemoryPreference Staging();
+
+        // GPU写入、CPU读取 (截图/回读)
+        static MemoryPreference Readback();
+    };
+
+    /**
+     * 显存子分配器
+     * 每种内存类型按大页 (page) 调用一次 vkAllocateMemory，页内使用 buddy 算法分配，
+     * 上千个 Buffer 只占用少量 VkDeviceMemory (maxMemoryAllocationCount 最低只有 4096)
+     */
+    class MemoryAllocator final {
+    public:
+        // linear 资源 (buffer / linear image) 和 optimal image 分页存放，天然满足 bufferImageGranularity
+        enum class ResourceKind {
+            Linear,
+            Optimal
+        };
+
+        struct Allocation {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize offset = 0;
+            VkDeviceSize size = 0;
+            void *mapped = nullptr; // host可见内存会持久映射，指向 offset 处
+            uint32_t memoryTypeIndex = 0;
+
+            // 以下为分配器内部使用
+            uint32_t page = 0;
+            uint32_t order = 0;
+            bool dedicated = false;
+        };
+
+        struct Stats {
+            uint32_t deviceMemoryCount; // 当前 vkAllocateMemory 的数量
+            VkDeviceSize reservedBytes;  // 所有 VkDeviceMemory 的总大小
+            VkDeviceSize usedBytes;      // 分配给资源的大小 (按 buddy 块大小统计)
+            VkDeviceSize peakUsedBytes;
+        };
+
+        MemoryAllocator(VkDevice device, const VkPhysicalDeviceMemoryProperties &memoryProperties);
+
+        ~MemoryAllocator();
+
+        Allocation Allocate(const VkMemoryRequirements &requirements, uint32_t memoryTypeIndex, ResourceKind kind);
+
+        void Free(const Allocation &allocation);
+
+        // allocation 所在块对应的映射范围 (满足 nonCoherentAtomSize 对齐)，用于 flush / invalidate
+        VkMappedMemoryRange GetMappedRange(const Allocation &allocation) const;
+
+        Stats GetStats();
+
+    private:
+        struct Page {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            void *mapped = nullptr;
+            uint32_t memoryTypeIndex = 0;
+            ResourceKind kind = ResourceKind::Linear;
+            VkDeviceSize usedBytes = 0;
+            std::vector<std::set<VkDeviceSize>> freeLists; // 每一阶空闲块的偏移
+        };
+
+        VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void **mapped);
+
+        void freeDeviceMemory(VkDeviceMemory memory, VkDeviceSize size, void *mapped);
+
+        VkDeviceSize pageSizeFor(uint32_t memoryTypeIndex) const;
+
+        uint32_t createPage(uint32_t memoryTypeIndex, ResourceKind kind);
+
+        bool allocateFromPage(Page &page, uint32_t order, VkDeviceSize &offset);
+
+        void releasePageIfSpare(uint32_t pageIndex);
+
+        VkDevice device_;
+
+        VkPhysicalDeviceMemoryProperties memoryProperties_;
+
+        std::vector<std::unique_ptr<Page>> pages_; // 释放的页为 nullptr，下标复用
+
+        Stats stats_{};
+
+        std::mutex mutex_;
+    };
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include "tool.h"
+
+namespace render_2d {
+    /**
+     * 持久化到磁盘的 VkPipelineCache，所有 vkCreate*Pipelines 共用
+     * 启动时读取缓存文件，header (vendorID/deviceID/UUID) 与当前设备不一致时丢弃
+     * 析构时写回，先写临时文件再 rename，避免进程中途退出留下损坏的缓存
+     */
+    class PipelineCache final {
+    public:
+        PipelineCache(const std::string &path, VkDevice device, VkPhysicalDevice gpu);
+
+        ~PipelineCache();
+
+        VkPipelineCache GetCache() const {
+            return cache_;
+        }
+
+        // 将当前缓存内容写回磁盘
+        void Save();
+
+    private:
+        // 缓存数据是否由当前设备、当前驱动生成
+        bool validateHeader(const std::string &data) const;
+
+        std::string path_;
+
+        VkPipelineCache cache_;
+
+        VkPhysicalDeviceProperties properties_;
+
+        VkDevice device_;
+    };
+}
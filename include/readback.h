@@ -0,0 +1,98 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "tool.h"
+#include "buffer.h"
+
+namespace render_2d {
+    // 回读得到的一帧画面，像素行紧密排列，每像素4字节
+    struct CapturedImage {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        VkFormat format = VK_FORMAT_UNDEFINED; // R8G8B8A8 或 B8G8R8A8 (交换链)
+        std::vector<uint8_t> pixels;
+
+        // 转换为 RGBA 顺序 (B8G8R8A8 交换 R/B 通道)
+        void ConvertToRGBA();
+    };
+
+    /**
+     * 异步帧回读
+     * 每一帧一个 host可见 (优先 HOST_CACHED) 的回读 buffer，render pass 之后在同一个 commandBuffer 中
+     * 录制 vkCmdCopyImageToBuffer，等到该帧下一次 BeginFrame 等待上一次提交完成时 (frameCount 帧之后) 再取出数据并回调，
+     * 整个过程不阻塞渲染
+     */
+    class ReadbackRing final {
+    public:
+        using Callback = std::function<void(CapturedImage &&image)>;
+
+        ReadbackRing(uint32_t frameCount, VkDevice device);
+
+        ~ReadbackRing();
+
+        /**
+         * 在 render pass 结束后录制拷贝，image 当前布局为 layout，拷贝完成后恢复为 layout
+         * 调用前该帧之前的提交必须已经执行完毕
+         */
+        void Record(VkCommandBuffer cmd, uint32_t frame, VkImage image, VkImageLayout layout, VkExtent2D extent,
+                    VkFormat format);
+
+        // 包含拷贝的 commandBuffer 提交成功之后调用，Collect 时才会回调；提交失败时不调用，回读 buffer 不会被当作结果交付
+        void Arm(uint32_t frame, Callback callback);
+
+        // 该帧上一次提交完成之后调用，交付该帧的回读结果
+        void Collect(uint32_t frame);
+
+        // GPU 空闲后交付所有未交付的结果 (销毁前调用)
+        void CollectAll();
+
+    private:
+        struct Slot {
+            std::unique_ptr<Buffer> buffer;
+            Callback callback;
+            VkExtent2D extent;
+            VkFormat format;
+        };
+
+        std::vector<Slot> slots_;
+
+        VkDevice device_;
+    };
+
+    /**
+     * 图片编码线程，避免 PNG 压缩占用渲染线程
+     * 路径以 .png 结尾时编码为 PNG，否则按原始 RGBA 字节写入
+     */
+    class ImageWriter final {
+    public:
+        ImageWriter();
+
+        // 等待队列中的图片全部写完后退出线程
+        ~ImageWriter();
+
+        void Write(const std::string &path, CapturedImage &&image);
+
+    private:
+        struct Job {
+            std::string path;
+            CapturedImage image;
+        };
+
+        void run();
+
+        static void writeFile(Job &job);
+
+        std::deque<Job> jobs_;
+
+        std::mutex mutex_;
+
+        std::condition_variable cond_;
+
+        bool stop_ = false;
+
+        std::thread thread_;
+    };
+}
@@ -7,10 +7,20 @@
 #include "context.h"
 #include "shader.h"
 #include "renderer.h"
+#include "cpu_profiler.h"
 
 namespace render_2d {
     void Init(const std::vector<const char *> &extensions, CreateSurfaceFunc func, int width, int height);
 
+    // 多 GPU 时固定使用某个设备 (设备序号或 deviceUUID)，需在 Init 之前调用，也可以设置环境变量 RENDER2D_DEVICE
+    void SetPreferredDevice(const std::string &device);
+
+    /**
+     * headless 模式：不需要窗口和 surface，渲染到 frameCount 个 width x height 的离屏图像
+     * 通过 Renderer::ReadPixels 取回画面，可以运行在 lavapipe / SwiftShader 上
+     */
+    void InitHeadless(const std::vector<const char *> &extensions, int width, int height, int frameCount = 2);
+
     void Quit();
 
     Renderer *GetRenderer();
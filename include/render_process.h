@@ -16,7 +16,8 @@ namespace render_2d {
         ~RenderProcess();
 
         VkPipeline pipeline_;
-        VkPipelineLayout layout_;
+        VkPipeline immediatePipeline_; // 立即绘制：不读实例流，变换和颜色来自 push constant
+        VkPipelineLayout layout_; // 两个 pipeline 共用，切换 pipeline 时已绑定的描述符集保持有效；由 LayoutCache 持有
         VkRenderPass renderPass_;
 
     private:
@@ -24,7 +25,9 @@ namespace render_2d {
 
         void initRenderPass();
 
-        void createPipeline(Shader &shader);
+        // inputs 为 vertex shader 反射出的输入，只启用它实际读取的属性和 binding
+        VkPipeline createPipeline(const std::vector<VkPipelineShaderStageCreateInfo> &stages,
+                                  const std::vector<VertexInput> &inputs);
 
     private:
         VkDevice &device_;
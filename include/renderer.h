@@ -3,6 +3,13 @@
 #include <utility>
 #include "context.h"
 #include "buffer.h"
+#include "uniform_ring.h"
+#include "readback.h"
+#include "texture.h"
+#include "texture_atlas.h"
+#include "font.h"
+#include "thread_pool.h"
+#include "gpu_profiler.h"
 
 namespace render_2d {
     class Renderer final {
@@ -11,12 +18,85 @@ namespace render_2d {
 
         ~Renderer();
 
+        // 开始一帧：等待该帧上一次提交完成，清空顶点流
+        void BeginFrame();
+
+        // 将矩形追加到当前帧的实例流中，EndFrame 时统一绘制
         void DrawRect(const Rect &rect);
 
+        // 录制并提交当前帧所有的矩形，然后 present
+        void EndFrame();
+
         void SetDrawColor(const Color &color);
 
+        /**
+         * 绘制纹理矩形，uvRect 为采样的纹理区域 (u0, v0, u1, v1)，颜色 = tint * 纹理颜色
+         * texture 需要在本帧执行完之前保持有效
+         */
+        void DrawTexturedRect(const Rect &rect, const Texture &texture,
+                              const glm::vec4 &uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+                              const Color &tint = Color{1.0f, 1.0f, 1.0f, 1.0f});
+
+        /**
+         * 绘制 UTF-8 文本，position 为第一行文本的左上角，size 为字号 (像素)
+         * 字形来自字体的图集缓存，整段文本通常只有一次 draw
+         */
+        void DrawText(Font &font, const std::string &text, const glm::vec2 &position, float size,
+                      const Color &color);
+
+        // 绘制图集中的一块区域，同一页上的区域连续绘制时只有一次 draw
+        void DrawTexturedRect(const Rect &rect, const AtlasRegion &region,
+                              const Color &tint = Color{1.0f, 1.0f, 1.0f, 1.0f});
+
+        /**
+         * 立即绘制：变换、颜色和纹理坐标通过 vkCmdPushConstants 传入，不写实例流也不绑定额外的 uniform，
+         * 适合光标、叠加层这类每帧变化且无法合批的单个矩形；与其他绘制保持调用顺序，并遵守当前的裁切区域
+         */
+        void DrawRectImmediate(const Rect &rect, const Color &color);
+
+        // model 作用在单位矩形 (-0.5 ~ 0.5) 上，可以包含旋转；texture 为空时为纯色
+        void DrawRectImmediate(const glm::mat4 &model, const Color &color, const Texture *texture = nullptr,
+                               const glm::vec4 &uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+
+        // 之后的 DrawRect 只在 clip 区域内可见 (与 DrawRect 同一像素坐标系，position 为中心)，通过动态 scissor 实现
+        void SetClipRect(const Rect &clip);
+
+        // 取消裁切，恢复整个 framebuffer
+        void ResetClipRect();
+
         void SetProjectMat(int right, int left, int bottom, int top, int far, int near);
 
+        // headless 模式下同步回读最近一次 EndFrame 的画面，RGBA8，行紧密排列
+        std::vector<uint8_t> ReadPixels();
+
+        /**
+         * 异步截取当前帧 (在 EndFrame 之前调用)：render pass 之后录制拷贝，
+         * maxFlightCount 帧之后在 BeginFrame 中回调，不等待GPU
+         */
+        void CaptureFrame(ReadbackRing::Callback callback);
+
+        // 异步截取当前帧并在后台线程写入文件 (.png 编码为 PNG，其他后缀写原始 RGBA 数据)
+        void CaptureFrameToFile(const std::string &path);
+
+        /**
+         * 多线程录制：threadCount > 1 时由工作线程把绘制列表按实例数分段录制到 secondary commandBuffer 中，
+         * 绘制量不足以分成两段时仍直接录制；每个线程每帧使用独立的 command pool；threadCount <= 1 时恢复在主 commandBuffer 中直接录制
+         */
+        void SetRecordThreadCount(uint32_t threadCount);
+
+        // 窗口 framebuffer 尺寸变化时调用，下一次 EndFrame 前重建交换链；尺寸为0 (最小化) 时跳过绘制
+        void Resize(int width, int height);
+
+        // GPU 耗时：frame / upload / render pass / batch 和 immediate (单线程录制时) / readback 区间
+        GpuProfiler &GetGpuProfiler() {
+            return *gpuProfiler_;
+        }
+
+        // 上一帧实际录制的 draw call (vkCmdDrawIndexed) 次数，不含完全被裁掉的段
+        uint32_t GetDrawCallCount() const {
+            return drawCalls_;
+        }
+
     private:
         struct MVP {
             glm::mat4 project;
@@ -24,55 +104,99 @@ namespace render_2d {
             glm::mat4 model;
         };
 
-        std::vector<VkFence> fences_;
+        std::vector<uint64_t> frameValues_; // 每帧最近一次提交在队列时间线上的值，0 表示还没有提交
 
         std::vector<VkSemaphore> imageAvaliableSems_;
 
         std::vector<VkSemaphore> renderFinishSems_;
 
-        std::vector<VkCommandBuffer> cmdBufs_;
-
         int maxFlightCount_;
 
         int curFrame_ = 0;
 
-        std::unique_ptr<Buffer> hostVertexBuffer_; // 使用CPU&GPU共享IO内存 buffer
+        int lastFrame_ = 0; // 最近一次提交的帧
+
+        std::optional<uint32_t> lastImageIndex_; // 最近一次提交使用的图像
+
+        bool frameStarted_ = false;
+
+        bool swapchainDirty_ = false; // 交换链需要重建 (尺寸变化 / OUT_OF_DATE / SUBOPTIMAL)
+
+        int width_;
+
+        int height_;
+
+        Color drawColor_;
+
+        std::vector<RectInstance> batchInstances_; // 当前帧CPU端累积的矩形实例
+
+        // 裁切区域和纹理相同的一段连续实例，对应一次 vkCmdSetScissor + vkCmdDrawIndexed
+        struct DrawRange {
+            std::optional<glm::vec4> clip; // (x0, y0, x1, y1)，nullopt 表示不裁切
+            VkDescriptorSet texture; // set = 1
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+            std::optional<uint32_t> immediate; // 立即绘制在 immediateDraws_ 中的下标，此时不使用实例
+        };
+
+        std::vector<DrawRange> drawRanges_;
 
-        std::unique_ptr<Buffer> deviceVertexBuffer_; // GPU独占的buffer
+        // 多线程录制时每个工作线程录制的一段 DrawRange，大的实例段会在实例边界上拆开，跨帧复用避免重复分配
+        std::vector<std::vector<DrawRange>> recordSlices_;
 
-        std::unique_ptr<Buffer> hostIndicesBuffer_; // 顶点索引buffer
+        uint32_t drawCalls_ = 0;
+
+        std::vector<RectPushConstants> immediateDraws_; // 当前帧立即绘制的 push constant 数据
+
+        std::optional<glm::vec4> clipRect_;
+
+        std::vector<std::unique_ptr<Buffer>> instanceStreamBufs_; // 每一帧一个 host可见的实例流 buffer
+
+        std::unique_ptr<Buffer> deviceVertexBuffer_; // GPU独占的buffer (单位矩形的4个顶点)
 
         std::unique_ptr<Buffer> deviceIndicesBuffer_; // GPU独占的顶点索引buffer
 
-        std::vector<std::unique_ptr<Buffer>> hostColorUniformBufs; // GPU独占的uniform buffer
+        std::unique_ptr<UniformRing> uniformRing_; // 所有帧共享的 uniform 环形 buffer
 
-        std::vector<std::unique_ptr<Buffer>> localColorUniformBufs_; // GPU独占的
+        std::unique_ptr<Texture> whiteTexture_; // DrawRect 使用的 1x1 白色纹理
 
-        std::vector<std::unique_ptr<Buffer>> hostMVPUniformBufs_;
+        std::unique_ptr<ReadbackRing> readback_; // 每帧一个回读 buffer
 
-        std::vector<std::unique_ptr<Buffer>> localMVPUniformBufs_;
+        std::unique_ptr<GpuProfiler> gpuProfiler_;
 
-        VkDescriptorPool colorDescriptorPool_;
+        ReadbackRing::Callback captureCallback_; // 当前帧的截图请求
 
-        VkDescriptorPool mvpDescriptorPool_;
+        std::unique_ptr<ImageWriter> imageWriter_; // 第一次写文件时创建
 
-        std::vector<VkDescriptorSet> colorDescriptorSets_;
+        std::unique_ptr<ThreadPool> recordWorkers_; // 多线程录制的工作线程，未开启时为空
 
-        std::vector<VkDescriptorSet> mvpDescriptorSets_;
+        VkDescriptorPool mvpDescriptorPool_;
 
-        void createFences();
+        VkDescriptorSet mvpDescriptorSet_; // dynamic uniform buffer，绑定时指定偏移
 
         void createSemaphores();
 
+        void createRenderFinishSemaphores();
+
+        void waitAllFrames();
+
         void createCmdBuffers();
 
         void createVertexIndexBuffer();
 
         void bufferVertexData();
 
+        void createInstanceStreams();
+
+        std::unique_ptr<Buffer> createInstanceStreamBuffer(uint64_t size);
+
+        void reserveInstanceStream(size_t instanceCount);
+
         void createUniformBuffers();
 
-        void transformBuffer2Device(Buffer &src, Buffer &dst, size_t size, size_t srcOffset, size_t dstOffset);
+        void createWhiteTexture();
+
+        void pushInstance(const RectInstance &instance, VkDescriptorSet texture);
 
         void createDescriptorPool();
 
@@ -82,7 +206,29 @@ namespace render_2d {
 
         void initMats();
 
-        void bufferMVPUniformData(const glm::mat4 modelMat);
+        uint32_t bufferMVPUniformData(const glm::mat4 modelMat);
+
+        /**
+         * 录制 [first, last) 中的 DrawRange，实例化绘制与立即绘制之间按需切换 pipeline，返回录制的 draw call 数
+         * profiler 不为空时每个绘制记录为 "batch" / "immediate" 区间
+         */
+        uint32_t recordBatch(VkCommandBuffer cmd, const DrawRange *first, const DrawRange *last, uint32_t mvpOffset,
+                         GpuProfiler *profiler = nullptr);
+
+        // 按绘制量把 drawRanges_ 切到 recordSlices_ 中，返回段数，返回 1 表示不值得多线程录制
+        uint32_t splitRecordSlices();
+
+        uint32_t recordParallel(VkCommandBuffer cmd, VkFramebuffer framebuffer, uint32_t mvpOffset, uint32_t sliceCount);
+
+        bool acquireTarget(uint32_t &imageIndex);
+
+        VkResult acquireNextImage(uint32_t &imageIndex);
+
+        bool recreateSwapchain();
+
+        void setViewport(VkCommandBuffer cmd);
+
+        VkRect2D clipToScissor(const std::optional<glm::vec4> &clip);
 
         glm::mat4 projectMat_;
 
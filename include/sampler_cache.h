@@ -0,0 +1,27 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include "tool.h"
+
+namespace render_2d {
+    /**
+     * 共享的 VkSampler 缓存，相同的过滤 / 寻址方式只创建一个 sampler
+     * 由 Context 持有，sampler 在 Context 销毁时统一释放
+     */
+    class SamplerCache final {
+    public:
+        explicit SamplerCache(VkDevice device);
+
+        ~SamplerCache();
+
+        VkSampler Get(VkFilter filter, VkSamplerAddressMode addressMode);
+
+    private:
+        std::map<std::pair<VkFilter, VkSamplerAddressMode>, VkSampler> samplers_;
+
+        std::mutex mutex_;
+
+        VkDevice device_;
+    };
+}
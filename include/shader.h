@@ -5,29 +5,57 @@
 #pragma once
 
 #include "tool.h"
+#include "layout_cache.h"
 
 namespace render_2d {
     class Shader final {
     public:
-        Shader(const std::string &vertex_source, const std::string &fragment_source, VkDevice &device);
+        /**
+         * immediate_vertex_source 为立即绘制 (push constant) 使用的 vertex shader，与实例化绘制共用 fragment shader
+         * 三个模块的反射结果合并为一个 pipeline layout，两个 pipeline 共用；布局从 layoutCache 中取得，由它持有
+         */
+        Shader(const std::string &vertex_source, const std::string &immediate_vertex_source,
+               const std::string &fragment_source, VkDevice &device, LayoutCache &layoutCache);
 
         ~Shader();
 
         std::vector<VkPipelineShaderStageCreateInfo> GetShaderStages();
 
-        const std::vector<VkDescriptorSetLayout> &GetDescriptorSetLayouts() const { return setLayouts_; }
+        std::vector<VkPipelineShaderStageCreateInfo> GetImmediateShaderStages();
+
+        const std::vector<VkDescriptorSetLayout> &GetDescriptorSetLayouts() const { return layout_.setLayouts; }
+
+        VkPipelineLayout GetPipelineLayout() const { return layout_.layout; }
+
+        const ShaderReflection &GetReflection() const { return reflection_; }
+
+        // 实例化绘制 / 立即绘制的 vertex shader 实际读取的输入 (按 location 排序)
+        const std::vector<VertexInput> &GetVertexInputs() const { return vertexInputs_; }
+
+        const std::vector<VertexInput> &GetImmediateVertexInputs() const { return immediateVertexInputs_; }
 
     private:
-        std::vector<VkDescriptorSetLayout> setLayouts_;
+        LayoutCache::PipelineLayout layout_;
+
+        ShaderReflection reflection_; // 所有模块合并后的结果
+
+        std::vector<VertexInput> vertexInputs_;
+
+        std::vector<VertexInput> immediateVertexInputs_;
 
         std::vector<VkPipelineShaderStageCreateInfo> stages_;
 
+        std::vector<VkPipelineShaderStageCreateInfo> immediateStages_;
+
         void initStages();
 
-        void initDescriptorSetLayouts();
+        void initLayout(const std::string &vertex_source, const std::string &immediate_vertex_source,
+                        const std::string &fragment_source, LayoutCache &layoutCache);
 
         VkShaderModule vertexShaderModule_;
 
+        VkShaderModule immediateVertexShaderModule_;
+
         VkShaderModule fragmentShaderModule_;
 
     private:
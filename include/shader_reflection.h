@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include "tool.h"
+
+namespace render_2d {
+    struct DescriptorBinding {
+        uint32_t set;
+        uint32_t binding;
+        VkDescriptorType type;
+        uint32_t count;
+        VkShaderStageFlags stages;
+    };
+
+    struct VertexInput {
+        uint32_t location;
+        VkFormat format; // 按 shader 中的输入类型推导，例如 vec2 -> VK_FORMAT_R32G32_SFLOAT，矩阵按列拆成多个输入
+    };
+
+    /**
+     * SPIR-V 反射：直接解析 ReadWholeFile 读入的 SPIR-V words，提取描述符绑定、push constant 范围和 vertex 输入
+     * 多个 stage / shader 的结果可以 Merge 成一个，用来创建它们共用的 pipeline layout
+     * SPIR-V 中不区分动态 uniform buffer，需要时由调用方通过 MakeDynamic 指定
+     */
+    struct ShaderReflection {
+        VkShaderStageFlags stages = 0;
+        std::vector<DescriptorBinding> bindings; // 按 (set, binding) 排序
+        std::vector<VkPushConstantRange> pushConstants;
+        std::vector<VertexInput> vertexInputs; // 只有 vertex shader 有，按 location 排序
+
+        // SPIR-V 格式错误或 vertex 输入不是 32 位标量 / 向量 / 矩阵时抛出 std::runtime_error
+        static ShaderReflection Reflect(const std::string &spirv);
+
+        // 合并另一个 shader 的反射结果，同一个 (set, binding) 的类型或数量不一致时抛出 std::runtime_error
+        void Merge(const ShaderReflection &other);
+
+        // 把 (set, binding) 的 UNIFORM_BUFFER / STORAGE_BUFFER 改为对应的 DYNAMIC 类型
+        void MakeDynamic(uint32_t set, uint32_t binding);
+
+        // 每个 set 的绑定 (下标为 set 编号，中间没有使用的 set 为空)
+        std::vector<std::vector<VkDescriptorSetLayoutBinding>> GetSetLayoutBindings() const;
+    };
+}
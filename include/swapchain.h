@@ -5,6 +5,7 @@
 #pragma once
 
 #include "tool.h"
+#include "memory_allocator.h"
 
 namespace render_2d {
     class SwapChain final {
@@ -13,6 +14,9 @@ namespace render_2d {
 
         SwapChain(int width, int height);
 
+        // 离屏模式 (headless)：不创建 VkSwapchainKHR，创建 imageCount 个 RGBA8 颜色图像作为渲染目标
+        SwapChain(int width, int height, uint32_t imageCount);
+
         ~SwapChain();
 
         struct SwapChainInfo {
@@ -26,6 +30,9 @@ namespace render_2d {
             VkSurfaceTransformFlagBitsKHR transform;
 
             VkPresentModeKHR presentMode;
+
+            // 图像用途，表面支持时额外加上 TRANSFER_SRC 用于截图回读
+            VkImageUsageFlags imageUsage;
         };
 
         SwapChainInfo info;
@@ -40,5 +47,30 @@ namespace render_2d {
         void CreateImageViews();
 
         void CreateFramebuffers(int width, int height);
+
+        bool IsOffscreen() const {
+            return swapchain == VK_NULL_HANDLE;
+        }
+
+        /**
+         * 窗口尺寸变化或 OUT_OF_DATE 时重建交换链: 以旧交换链为 oldSwapchain 创建新交换链，
+         * 只重建 image view 和 framebuffer，RenderPass / Pipeline 保持不变 (图像格式不变)
+         * 调用前需保证GPU不再使用旧的 framebuffer；表面尺寸为0 (最小化) 时返回 false，保持原状态
+         * 旧交换链上可能还有排队中的 present，交给 DeletionQueue 在 retireFrames 帧之后销毁
+         */
+        bool Recreate(int width, int height, uint32_t retireFrames);
+
+    private:
+        void createSwapchain(VkSwapchainKHR oldSwapchain);
+
+        void destroyImageViews();
+
+        void destroyFramebuffers();
+
+        void createOffscreenImages();
+
+        void destroyOffscreenImages();
+
+        std::vector<MemoryAllocator::Allocation> imageAllocations_; // 离屏图像的显存
     };
 }
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "tool.h"
+#include "memory_allocator.h"
+#include "descriptor_allocator.h"
+
+namespace render_2d {
+    /**
+     * 2D 纹理：RGBA8 像素上传到 DEVICE_LOCAL、optimal tiling 的 VkImage
+     * 上传通过 UploadManager 登记，随下一次 Flush (一般是下一帧提交前) 一起提交，不会逐张等待GPU
+     * 每个纹理持有一个 set = 1 的 combined image sampler 描述符集，从 Context 共享的描述符池中分配
+     * 纹理必须在使用它的帧执行完之后才能销毁
+     */
+    class Texture final {
+    public:
+        // 使用 stb_image 解码图片文件，统一转换为 RGBA8
+        explicit Texture(const std::string &path, VkFilter filter = VK_FILTER_LINEAR);
+
+        // pixels 为紧密排列的 RGBA8 数据
+        Texture(uint32_t width, uint32_t height, const void *pixels, VkFilter filter = VK_FILTER_LINEAR);
+
+        ~Texture();
+
+        uint32_t GetWidth() const { return width_; }
+
+        uint32_t GetHeight() const { return height_; }
+
+        VkDescriptorSet GetDescriptorSet() const { return descriptorSet_.set; }
+
+        /**
+         * 局部更新：只上传 offset / extent 区域，pixels 为该区域紧密排列的 RGBA8 数据
+         * 与之前的上传合并到同一批次提交
+         */
+        void Update(const void *pixels, VkOffset2D offset, VkExtent2D extent);
+
+    private:
+        void createImage();
+
+        void createImageView();
+
+        void createDescriptorSet(VkFilter filter);
+
+        void upload(const void *pixels);
+
+        uint32_t width_;
+
+        uint32_t height_;
+
+        VkImage image_;
+
+        VkImageView view_;
+
+        MemoryAllocator::Allocation allocation_;
+
+        DescriptorAllocator::Allocation descriptorSet_;
+    };
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "tool.h"
+#include "texture.h"
+#include "../stb_image/stb_rect_pack.h"
+
+namespace render_2d {
+    // 图集中的一块区域，绘制时使用 texture + uvRect
+    struct AtlasRegion {
+        const Texture *texture;
+        glm::vec4 uvRect; // (u0, v0, u1, v1)
+        uint32_t page;
+        uint32_t x, y;
+        uint32_t width, height;
+    };
+
+    /**
+     * 纹理图集：用 stb_rect_pack 把大量小图 (图标、字形、精灵) 打包到少数几张大纹理页中
+     * 同一页上的区域共用一个描述符集，连续绘制时合并为一次 draw
+     * 支持增量插入，每次插入只上传新区域 (Texture::Update)，当前页放不下时新建一页
+     */
+    class TextureAtlas final {
+    public:
+        // padding 为区域之间的间隔像素，避免线性过滤采样到相邻区域
+        explicit TextureAtlas(uint32_t pageSize = 1024, VkFilter filter = VK_FILTER_LINEAR, uint32_t padding = 1);
+
+        ~TextureAtlas();
+
+        // 插入 RGBA8 图像，图像比页面还大时返回 nullopt
+        std::optional<AtlasRegion> Add(uint32_t width, uint32_t height, const void *pixels);
+
+        // 使用 stb_image 解码后插入
+        std::optional<AtlasRegion> AddFile(const std::string &path);
+
+        size_t GetPageCount() const { return pages_.size(); }
+
+        const Texture &GetPage(uint32_t page) const { return *pages_[page]->texture; }
+
+        uint32_t GetPageSize() const { return pageSize_; }
+
+    private:
+        struct Page {
+            std::unique_ptr<Texture> texture;
+            stbrp_context context;
+            std::vector<stbrp_node> nodes;
+        };
+
+        Page &createPage();
+
+        // 在 page 中分配 width x height (含 padding) 的空间
+        static bool pack(Page &page, uint32_t width, uint32_t height, uint32_t &x, uint32_t &y);
+
+        std::vector<std::unique_ptr<Page>> pages_; // stbrp_context 内部保存 nodes 指针，Page 不能移动
+
+        uint32_t pageSize_;
+
+        uint32_t padding_;
+
+        VkFilter filter_;
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "tool.h"
+
+namespace render_2d {
+    /**
+     * 固定数量的工作线程，用于并行录制 secondary commandBuffer
+     * ParallelFor 把 [0, count) 分给工作线程执行并阻塞到全部完成，
+     * task 的第二个参数为执行它的线程编号 [0, threadCount)，用于选择线程独占的资源 (如 command pool)
+     */
+    class ThreadPool final {
+    public:
+        using Task = std::function<void(uint32_t index, uint32_t thread)>;
+
+        explicit ThreadPool(uint32_t threadCount);
+
+        ~ThreadPool();
+
+        uint32_t GetThreadCount() const { return static_cast<uint32_t>(threads_.size()); }
+
+        void ParallelFor(uint32_t count, const Task &task);
+
+    private:
+        void run(uint32_t thread);
+
+        std::vector<std::thread> threads_;
+
+        std::mutex mutex_;
+
+        std::condition_variable cond_; // 通知工作线程有新任务
+
+        std::condition_variable doneCond_; // 通知调用线程任务全部完成
+
+        const Task *task_ = nullptr;
+
+        uint32_t count_ = 0;
+
+        uint32_t next_ = 0;
+
+        uint32_t finished_ = 0;
+
+        uint64_t generation_ = 0;
+
+        bool stop_ = false;
+    };
+}
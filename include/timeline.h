@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include "tool.h"
+
+namespace render_2d {
+    /**
+     * 队列时间线：一个 timeline semaphore，每次向队列提交都 signal 一个单调递增的值
+     * 子系统记下提交时得到的值，之后直接查询 / 等待该点，不需要为每次提交创建 fence
+     * Submit 需要与 vkQueueSubmit 一样在提交线程中调用，查询和等待可以在任意线程
+     */
+    class Timeline final {
+    public:
+        // 跨队列的等待：在 stage 阶段等待另一条时间线到达 value
+        struct WaitPoint {
+            const Timeline *timeline;
+            uint64_t value;
+            VkPipelineStageFlags stage;
+        };
+
+        explicit Timeline(VkDevice device);
+
+        ~Timeline();
+
+        /**
+         * 提交 submitInfo 并额外 signal 下一个时间线值，成功时通过 value 返回该值
+         * submitInfo 中的等待 / signal 信号量都必须是 binary semaphore，其它时间线上的等待通过 waits 指定
+         */
+        VkResult Submit(VkQueue queue, const VkSubmitInfo &submitInfo, uint64_t &value,
+                        const std::vector<WaitPoint> &waits = {});
+
+        // 最近一次成功提交的值，0 表示还没有提交
+        uint64_t LastSubmitted() const {
+            return lastSubmitted_.load();
+        }
+
+        // GPU 已经执行完的最大值
+        uint64_t Completed();
+
+        bool IsComplete(uint64_t value);
+
+        // 阻塞直到 value 对应的提交执行完毕
+        void Wait(uint64_t value);
+
+        // 等待所有已提交的工作
+        void WaitIdle() {
+            Wait(LastSubmitted());
+        }
+
+        VkSemaphore semaphore_;
+
+    private:
+        void advance(uint64_t value);
+
+        VkDevice device_;
+
+        std::atomic<uint64_t> lastSubmitted_{0};
+
+        std::atomic<uint64_t> completed_{0};
+    };
+}
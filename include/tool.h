@@ -7,6 +7,7 @@
 #include <memory>
 #include <cassert>
 #include <optional>
+#include <array>
 #include <vector>
 #include <iostream>
 #include <cstring>
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "tool.h"
+#include "buffer.h"
+
+namespace render_2d {
+    /**
+     * 每帧 uniform 数据的环形分配器
+     * 一个持久映射的 host可见 buffer 按 frameCount 等分，每一帧只写自己的区域，
+     * 写入即 bump-pointer + memcpy，通过 dynamic uniform buffer 的偏移绑定，不需要任何队列提交
+     */
+    class UniformRing final {
+    public:
+        UniformRing(uint64_t frameSize, uint32_t frameCount, VkDevice device, VkPhysicalDevice gpu);
+
+        ~UniformRing();
+
+        // 切换到 frame 的区域并清空，调用前必须保证该帧之前的提交已经执行完毕
+        void BeginFrame(uint32_t frame);
+
+        // 写入 uniform 数据，返回 vkCmdBindDescriptorSets 需要的动态偏移
+        uint32_t Push(const void *data, uint64_t size);
+
+        template<typename T>
+        uint32_t Push(const T &data) {
+            return Push(&data, sizeof(T));
+        }
+
+        VkBuffer GetBuffer() const { return buffer_->buffer_; }
+
+    private:
+        std::unique_ptr<Buffer> buffer_;
+
+        uint64_t frameSize_;
+
+        uint64_t alignment_; // minUniformBufferOffsetAlignment
+
+        uint64_t frameBegin_ = 0;
+
+        uint64_t head_ = 0;
+    };
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <deque>
+#include "tool.h"
+#include "buffer.h"
+#include "timeline.h"
+#include "gpu_profiler.h"
+
+namespace render_2d {
+    /**
+     * 异步上传管理器
+     * 数据先写入持久映射的 staging 环形 buffer，记录 VkBufferCopy / VkBufferImageCopy，
+     * Flush 时把每个队列上挂起的拷贝合并到一个 commandBuffer 中提交，不等待GPU。
+     * 每次提交 signal 图像队列时间线上的一个值，该值完成后回收对应的 staging 空间和 commandBuffer。
+     */
+    class UploadManager final {
+    public:
+        // 每次 Flush 对应一个单调递增的 token，用于查询/等待上传完成
+        using Token = uint64_t;
+
+        // 上传使用的队列以及该队列的时间线
+        struct Queue {
+            uint32_t familyIndex;
+            VkQueue queue;
+            std::shared_ptr<Timeline> timeline;
+        };
+
+        /**
+         * transfer 为独立的传输队列 (没有时为空)：整块覆盖的大数据 (新纹理、整个 vertex buffer) 在传输队列上拷贝，
+         * 拷贝完成后通过队列族所有权转移交给图像队列，与渲染并行执行；局部更新和小数据仍在图像队列上拷贝
+         */
+        UploadManager(uint64_t stagingSize, const Queue &graphics, const std::optional<Queue> &transfer,
+                      VkDevice device);
+
+        ~UploadManager();
+
+        // 拷贝 data 到 staging 并登记 staging -> dst 的拷贝，返回该拷贝所属批次的 token (dst 必须存活到该批次 Flush)
+        Token Upload(Buffer &dst, const void *data, uint64_t size, uint64_t dstOffset = 0);
+
+        /**
+         * 拷贝紧密排列的像素到 staging 并登记 staging -> image 的拷贝 (offset / extent 为图像中的目标区域)
+         * 提交时图像先从 oldLayout 转换为 TRANSFER_DST_OPTIMAL，拷贝完成后转换为 SHADER_READ_ONLY_OPTIMAL
+         * 第一次上传传入 UNDEFINED，之后的局部更新传入 SHADER_READ_ONLY_OPTIMAL
+         */
+        Token UploadImage(VkImage dst, VkImageLayout oldLayout, const void *data, uint64_t size, VkOffset2D offset,
+                          VkExtent2D extent);
+
+        // 提交所有挂起的拷贝 (没有挂起的拷贝时不提交)，返回最近一次提交的 token
+        // profiler 不为空时图像队列上的拷贝记录为 "upload" 区间
+        Token Flush(GpuProfiler *profiler = nullptr);
+
+        bool IsComplete(Token token);
+
+        // 等待 token 对应的批次执行完毕，token 尚未提交时会先 Flush
+        void Wait(Token token);
+
+    private:
+        struct CopyGroup {
+            VkBuffer src;
+            Buffer *dst;
+            std::vector<VkBufferCopy> regions;
+        };
+
+        struct ImageCopyGroup {
+            VkBuffer src;
+            VkImage dst;
+            VkImageLayout oldLayout;
+            std::vector<VkBufferImageCopy> regions;
+        };
+
+        // 一个队列上的上传通道：command pool、可复用的 commandBuffer 和等待提交的拷贝
+        struct Lane {
+            Queue queue;
+            VkCommandPool pool;
+            std::vector<VkCommandBuffer> freeCmds;
+            std::vector<CopyGroup> buffers;
+            std::vector<ImageCopyGroup> images; // 每个图像一组，保证每批次每个图像只做一次布局转换
+        };
+
+        struct Submission {
+            Token token;
+            uint64_t timelineValue; // 该批次在图像队列时间线上的值
+            std::vector<std::pair<Lane *, VkCommandBuffer>> cmds; // 执行完毕后回收复用
+            uint64_t stagingEnd; // 该批次占用的 staging 空间的末尾 (虚拟偏移)
+            std::vector<std::unique_ptr<Buffer>> dedicatedStaging; // 超过环形 buffer 大小的上传
+        };
+
+        Lane createLane(const Queue &queue);
+
+        // 整块覆盖 (不需要保留原内容) 且足够大的上传走传输队列
+        Lane &selectLane(bool wholeResource, uint64_t size);
+
+        // 把 data 写入 staging (环形 buffer 或单独的 buffer)，返回拷贝源 buffer 和偏移
+        VkBuffer stage(const void *data, uint64_t size, uint64_t &srcOffset);
+
+        uint64_t allocateStaging(uint64_t size);
+
+        bool hasPending() const;
+
+        static bool hasPending(const Lane &lane);
+
+        bool overlapsPending(VkBuffer dst, uint64_t offset, uint64_t size) const;
+
+        ImageCopyGroup *findImageGroup(VkImage dst);
+
+        void submitGraphics(Submission &submission, GpuProfiler *profiler);
+
+        void submitTransfer(Submission &submission);
+
+        void recordCopies(VkCommandBuffer cmd, const Lane &lane);
+
+        void recordImageBarriers(VkCommandBuffer cmd, const Lane &lane, bool beforeCopy);
+
+        // 传输队列族 -> 图像队列族的所有权转移，release 在传输队列上录制，acquire 在图像队列上录制
+        void recordOwnershipBarriers(VkCommandBuffer cmd, const Lane &lane, bool release);
+
+        VkCommandBuffer acquireCmd(Lane &lane);
+
+        // 回收所有已完成的提交，wait 为 true 时至少等待最早的一次提交
+        void retire(bool wait);
+
+        VkDevice device_;
+
+        Lane graphics_;
+
+        std::optional<Lane> transfer_; // 没有独立的传输队列族时为空
+
+        std::vector<uint32_t> stagingQueueFamilies_; // 两个队列族都会读取 staging，使用 CONCURRENT 共享
+
+        std::unique_ptr<Buffer> staging_;
+
+        // staging 环形 buffer 的虚拟偏移，物理偏移 = 虚拟偏移 % size
+        uint64_t head_ = 0;
+
+        uint64_t tail_ = 0;
+
+        std::vector<std::unique_ptr<Buffer>> pendingDedicated_;
+
+        std::deque<Submission> inFlight_;
+
+        Token nextToken_ = 1; // 当前正在收集的批次
+
+        Token completedToken_ = 0;
+    };
+}
@@ -4,12 +4,6 @@
 
 namespace render_2d {
 
-    struct Vec {
-        static VkVertexInputAttributeDescription GetAttributeDescription();
-
-        static VkVertexInputBindingDescription GetBindingDescription();
-    };
-
     struct Color {
         float r, g, b, a;
     };
@@ -18,4 +12,30 @@ namespace render_2d {
         glm::vec2 position;
         glm::vec2 size;
     };
-}
\ No newline at end of file
+
+    // 实例化绘制时每个矩形写入实例流的数据 (binding 1, VK_VERTEX_INPUT_RATE_INSTANCE)
+    struct RectInstance {
+        glm::vec2 position;
+        glm::vec2 size;
+        Color color;
+        glm::vec4 uvRect; // 纹理坐标 (u0, v0, u1, v1)，纯色矩形采样 1x1 白色纹理
+    };
+
+    /**
+     * 立即绘制时每次 draw 的 push constant (vertex stage)，不经过实例流和 uniform buffer
+     * model 作用在单位矩形上，可以包含旋转；总大小必须在规范保证的 128 字节以内
+     */
+    struct RectPushConstants {
+        glm::mat4 model;
+        Color color;
+        glm::vec4 uvRect;
+    };
+
+    static_assert(sizeof(RectPushConstants) <= 128, "push constants must fit in the guaranteed 128 bytes");
+
+    struct Vec {
+        static std::array<VkVertexInputAttributeDescription, 5> GetAttributeDescriptions();
+
+        static std::array<VkVertexInputBindingDescription, 2> GetBindingDescriptions();
+    };
+}
@@ -0,0 +1,26 @@
+#version 450
+
+// 立即绘制：只使用 binding 0 的单位矩形顶点，变换、颜色和纹理坐标来自 push constant
+layout(location = 0) in vec2 inPosition;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragUV;
+
+layout(set = 0, binding = 0) uniform UniformBuffer {
+    mat4 project;
+    mat4 view;
+    mat4 model;
+} ubo;
+
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    vec4 color;
+    vec4 uvRect;
+} pc;
+
+
+void main() {
+    gl_Position = ubo.project * ubo.view * pc.model * vec4(inPosition, 0.0, 1.0);
+    fragColor = pc.color;
+    fragUV = mix(pc.uvRect.xy, pc.uvRect.zw, inPosition + 0.5);
+}
@@ -1,11 +1,13 @@
 #version 450
 
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragUV;
+
 layout(location = 0) out vec4 outColor;
 
-layout(set = 1, binding = 0) uniform UniformBuffer{
-    vec4 color;
-} ubo;
+// 纯色矩形绑定 1x1 白色纹理
+layout(set = 1, binding = 0) uniform sampler2D tex;
 
 void main() {
-    outColor = ubo.color;
-}
\ No newline at end of file
+    outColor = fragColor * texture(tex, fragUV);
+}
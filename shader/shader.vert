@@ -1,6 +1,15 @@
 #version 450
 
+// binding 0 : 单位矩形顶点
 layout(location = 0) in vec2 inPosition;
+// binding 1 : 矩形实例
+layout(location = 1) in vec2 inRectPosition;
+layout(location = 2) in vec2 inRectSize;
+layout(location = 3) in vec4 inColor;
+layout(location = 4) in vec4 inUVRect;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragUV;
 
 layout(set = 0, binding = 0) uniform UniformBuffer {
     mat4 project;
@@ -10,5 +19,9 @@ layout(set = 0, binding = 0) uniform UniformBuffer {
 
 
 void main() {
-    gl_Position = ubo.project * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
-}
\ No newline at end of file
+    vec2 position = inRectPosition + inPosition * inRectSize;
+    gl_Position = ubo.project * ubo.view * ubo.model * vec4(position, 0.0, 1.0);
+    fragColor = inColor;
+    // 单位矩形左上角 (-0.5, -0.5) 对应 (u0, v0)
+    fragUV = mix(inUVRect.xy, inUVRect.zw, inPosition + 0.5);
+}
@@ -1,70 +1,86 @@
 #include "../include/buffer.h"
+#include "../include/context.h"
 
 namespace render_2d {
-    Buffer::Buffer(uint64_t buffer_size, VkBufferUsageFlags bufferUsage, VkMemoryPropertyFlags property,
-                   VkDevice device, VkPhysicalDevice gpu) : device_(device), gpu_(gpu) {
+    Buffer::Buffer(uint64_t buffer_size, VkBufferUsageFlags bufferUsage, const MemoryPreference &preference,
+                   VkDevice device, const std::vector<uint32_t> &queueFamilies) : device_(device) {
         buffer_size_ = buffer_size;
-        createBuffer(buffer_size, bufferUsage);
-        auto info = queryMemoryInfo(buffer_, property);
+        createBuffer(buffer_size, bufferUsage, queueFamilies);
+        auto info = queryMemoryInfo(buffer_, preference);
         allocateMemory(info);
         bindingMemory();
 
-        if (property & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
-            vkMapMemory(device_, memory_, 0, buffer_size, 0, &map);
-        } else {
-            map = nullptr;
-        }
+        // host可见的页由分配器持久映射，这里只取自己 offset 处的指针 (选中的类型可能比要求的更多，如 ReBAR)
+        auto flags = Context::GetInstance().memoryProperties_.memoryTypes[info.index].propertyFlags;
+        map = (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? allocation_.mapped : nullptr;
+        coherent_ = flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
     }
 
+    // 在途的帧可能仍在使用该 buffer，交给延迟销毁队列，GPU 执行完后再释放
+    // deleter 可能在 Context 析构过程中执行，不能再通过 Context::GetInstance 访问分配器
     Buffer::~Buffer() {
-        if (map) {
-            vkUnmapMemory(device_, memory_);
+        auto &ctx = Context::GetInstance();
+        auto device = device_;
+        auto buffer = buffer_;
+        auto allocation = allocation_;
+        auto allocator = ctx.memoryAllocator_;
+        ctx.deletionQueue_->Push([device, buffer, allocation, allocator] {
+            vkDestroyBuffer(device, buffer, nullptr);
+            allocator->Free(allocation);
+        });
+    }
+
+    void Buffer::Flush() {
+        if (map && !coherent_) {
+            auto range = Context::GetInstance().memoryAllocator_->GetMappedRange(allocation_);
+            vkFlushMappedMemoryRanges(device_, 1, &range);
         }
+    }
 
-        vkDestroyBuffer(device_, buffer_, nullptr);
-        vkFreeMemory(device_, memory_, nullptr);
+    void Buffer::Invalidate() {
+        if (map && !coherent_) {
+            auto range = Context::GetInstance().memoryAllocator_->GetMappedRange(allocation_);
+            vkInvalidateMappedMemoryRanges(device_, 1, &range);
+        }
     }
 
     // 创建 vkBuffer
-    void Buffer::createBuffer(uint64_t size, VkBufferUsageFlags bufferUsage) {
+    void Buffer::createBuffer(uint64_t size, VkBufferUsageFlags bufferUsage, const std::vector<uint32_t> &queueFamilies) {
         VkBufferCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         createInfo.size = size;
         createInfo.usage = bufferUsage;                     // 当前buffer的用法
         createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // 队列独占模式
+        if (queueFamilies.size() > 1) {
+            createInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            createInfo.queueFamilyIndexCount = queueFamilies.size();
+            createInfo.pQueueFamilyIndices = queueFamilies.data();
+        }
         vkCreateBuffer(device_, &createInfo, nullptr, &buffer_);
     }
 
-    // 开辟对应大小的内存
+    // 从分配器的大页中子分配对应大小的内存
     void Buffer::allocateMemory(MemoryInfo info) {
-        VkMemoryAllocateInfo allocateInfo{};
-        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocateInfo.allocationSize = info.size;
-        allocateInfo.memoryTypeIndex = info.index;
-        vkAllocateMemory(device_, &allocateInfo, nullptr, &memory_);
+        allocation_ = Context::GetInstance().memoryAllocator_->Allocate(info.requirements, info.index,
+                                                                        MemoryAllocator::ResourceKind::Linear);
     }
 
     // 将 vkBuffer绑定对应内存上
     void Buffer::bindingMemory() {
-        vkBindBufferMemory(device_, buffer_, memory_, 0);
+        vkBindBufferMemory(device_, buffer_, allocation_.memory, allocation_.offset);
     }
 
-    // 查询 buffer在显存中的信息
-    Buffer::MemoryInfo Buffer::queryMemoryInfo(VkBuffer buffer, VkMemoryPropertyFlags property) {
+    // 查询 buffer在显存中的信息，内存类型必须在 memoryTypeBits 中并满足 preference
+    Buffer::MemoryInfo Buffer::queryMemoryInfo(VkBuffer buffer, const MemoryPreference &preference) {
         MemoryInfo info;
-        VkMemoryRequirements requirement{};
-        vkGetBufferMemoryRequirements(device_, buffer, &requirement);
-        info.size = requirement.size;
-
-        VkPhysicalDeviceMemoryProperties memoryProperties;
-        vkGetPhysicalDeviceMemoryProperties(gpu_, &memoryProperties);
+        vkGetBufferMemoryRequirements(device_, buffer, &info.requirements);
 
-        for (size_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
-            if ((1 << i) && requirement.memoryTypeBits || memoryProperties.memoryTypes[i].propertyFlags & property) {
-                info.index = i;
-            }
+        auto index = Context::GetInstance().FindMemoryType(info.requirements.memoryTypeBits, preference);
+        if (!index) {
+            throw std::runtime_error("Buffer failed to find a suitable memory type");
         }
+        info.index = index.value();
         return info;
     }
 
-}
\ No newline at end of file
+}
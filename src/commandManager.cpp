@@ -1,4 +1,5 @@
 #include "../include/commandManager.h"
+#include "../include/cpu_profiler.h"
 
 namespace render_2d {
 
@@ -6,11 +7,13 @@ namespace render_2d {
         std::cerr << "CommandManager created" << std::endl;
         graphicsQueueFamilyIndex_ = graphicsQueueFamilyIndex;
         device_ = device;
-        pool_ = createCommandPool();
+        pool_ = createCommandPool(VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
     }
 
     CommandManager::~CommandManager() {
         std::cerr << "CommandManager destroyed" << std::endl;
+        destroyThreadPools();
+        destroyPools(framePools_);
         vkDestroyCommandPool(device_, pool_, nullptr);
     }
 
@@ -34,16 +37,103 @@ namespace render_2d {
         return cmdBuffers;
     }
 
-    VkCommandPool CommandManager::createCommandPool() {
+    VkCommandPool CommandManager::createCommandPool(VkCommandPoolCreateFlags flags) {
         VkCommandPoolCreateInfo cmdPoolCreateInfo{};
         cmdPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        cmdPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        cmdPoolCreateInfo.flags = flags;
         // set 指定图形队列
         cmdPoolCreateInfo.queueFamilyIndex = graphicsQueueFamilyIndex_;
-        vkCreateCommandPool(device_, &cmdPoolCreateInfo, nullptr, &pool_);
+        VkCommandPool pool;
+        if (vkCreateCommandPool(device_, &cmdPoolCreateInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("CommandManager failed to create command pool");
+        }
         std::cerr << "CommandManager cmdPool created cur_queueFamilyIndex : "
                   << graphicsQueueFamilyIndex_ << std::endl;
-        return pool_;
+        return pool;
+    }
+
+    void CommandManager::InitFramePools(uint32_t frameCount) {
+        destroyPools(framePools_);
+        framePools_.resize(frameCount);
+        for (auto &framePool: framePools_) {
+            framePool.pool = createCommandPool(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        }
+    }
+
+    VkCommandBuffer CommandManager::AllocatePrimary(uint32_t frame) {
+        return acquire(framePools_[frame], VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    }
+
+    void CommandManager::InitThreadPools(uint32_t frameCount, uint32_t threadCount) {
+        destroyThreadPools();
+        threadPools_.resize(frameCount);
+        for (auto &framePools: threadPools_) {
+            framePools.resize(threadCount);
+            for (auto &framePool: framePools) {
+                // 每帧整体重置，commandBuffer 生命周期只有一帧
+                framePool.pool = createCommandPool(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+            }
+        }
+    }
+
+    VkCommandBuffer CommandManager::AllocateSecondary(uint32_t frame, uint32_t thread) {
+        return acquire(threadPools_[frame][thread], VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    }
+
+    void CommandManager::ResetFrame(uint32_t frame) {
+        RENDER2D_PROFILE_SCOPE("reset command pools");
+        if (frame < framePools_.size()) {
+            reset(framePools_[frame]);
+        }
+        if (frame < threadPools_.size()) {
+            for (auto &framePool: threadPools_[frame]) {
+                reset(framePool);
+            }
+        }
+    }
+
+    // 已分配的 commandBuffer 按顺序复用，不够时才向 pool 申请新的
+    VkCommandBuffer CommandManager::acquire(FramePool &framePool, VkCommandBufferLevel level) {
+        bool primary = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        auto &buffers = primary ? framePool.primaries : framePool.secondaries;
+        auto &used = primary ? framePool.usedPrimaries : framePool.usedSecondaries;
+        if (used == buffers.size()) {
+            VkCommandBufferAllocateInfo cmdInfo{};
+            cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            cmdInfo.commandBufferCount = 1;
+            cmdInfo.level = level;
+            cmdInfo.commandPool = framePool.pool;
+            VkCommandBuffer cmd;
+            if (vkAllocateCommandBuffers(device_, &cmdInfo, &cmd) != VK_SUCCESS) {
+                throw std::runtime_error("CommandManager failed to allocate command buffer");
+            }
+            buffers.push_back(cmd);
+        }
+        return buffers[used++];
+    }
+
+    void CommandManager::reset(FramePool &framePool) {
+        if (framePool.usedPrimaries == 0 && framePool.usedSecondaries == 0) {
+            return;
+        }
+        // 重置 pool 后其中的 commandBuffer 回到初始状态，可以直接重新录制；不释放内存，下一帧复用
+        vkResetCommandPool(device_, framePool.pool, 0);
+        framePool.usedPrimaries = 0;
+        framePool.usedSecondaries = 0;
+    }
+
+    void CommandManager::destroyPools(std::vector<FramePool> &framePools) {
+        for (auto &framePool: framePools) {
+            vkDestroyCommandPool(device_, framePool.pool, nullptr);
+        }
+        framePools.clear();
+    }
+
+    void CommandManager::destroyThreadPools() {
+        for (auto &framePools: threadPools_) {
+            destroyPools(framePools);
+        }
+        threadPools_.clear();
     }
 
     void CommandManager::ResetCmdPool() {
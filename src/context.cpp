@@ -1,3 +1,7 @@
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include <bitset>
 #include "../include/context.h"
 
 namespace render_2d {
@@ -16,6 +20,57 @@ namespace render_2d {
 
     std::unique_ptr<Context> Context::context_instance_ = nullptr;
 
+    std::string Context::deviceOverride_;
+
+    // 帧同步和资源回收都基于 timeline semaphore (Vulkan 1.2 核心功能)
+    static bool supportsTimelineSemaphore(VkPhysicalDevice device, const VkPhysicalDeviceProperties &properties) {
+        if (properties.apiVersion < VK_API_VERSION_1_2) {
+            return false;
+        }
+        VkPhysicalDeviceVulkan12Features supported12{};
+        supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 supported{};
+        supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported.pNext = &supported12;
+        vkGetPhysicalDeviceFeatures2(device, &supported);
+        return supported12.timelineSemaphore;
+    }
+
+    static bool supportsExtension(VkPhysicalDevice device, const char *name) {
+        uint32_t count = 0;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr);
+        std::vector<VkExtensionProperties> extensions(count);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &count, extensions.data());
+        return std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties &extension) {
+            return strcmp(extension.extensionName, name) == 0;
+        });
+    }
+
+    // deviceUUID 格式化为 32 位小写十六进制，1.0 设备查询不到时返回空
+    static std::string deviceUUID(VkPhysicalDevice device, const VkPhysicalDeviceProperties &properties) {
+        if (properties.apiVersion < VK_API_VERSION_1_1) {
+            return {};
+        }
+        VkPhysicalDeviceIDProperties idProperties{};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2(device, &properties2);
+
+        static const char *digits = "0123456789abcdef";
+        std::string uuid;
+        for (auto byte: idProperties.deviceUUID) {
+            uuid.push_back(digits[byte >> 4]);
+            uuid.push_back(digits[byte & 0xf]);
+        }
+        return uuid;
+    }
+
+    void Context::SetDeviceOverride(const std::string &device) {
+        deviceOverride_ = device;
+    }
+
     void Context::Init(const std::vector<const char *> &extensions, CreateSurfaceFunc func) {
         context_instance_.reset(new Context(extensions, std::move(func)));
     }
@@ -26,18 +81,40 @@ namespace render_2d {
 
     Context::Context(const std::vector<const char *> &extensions, CreateSurfaceFunc func) {
         createInstance(extensions);
+        // 获取glfw的surface，headless 模式没有 surface；选择设备时需要检查 present 支持
+        surface_ = func ? func(instance_) : VK_NULL_HANDLE;
         pickPhysicalDevice();
-        // 获取glfw的surface
-        surface_ = func(instance_);
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice_, &memoryProperties_);
         queryQueueFamilyIndices();
         createDevice();
         getQueues();
+        timeline_ = std::make_shared<Timeline>(device_);
+        if (transferQueue_ != VK_NULL_HANDLE) {
+            transferTimeline_ = std::make_shared<Timeline>(device_);
+        }
+        deletionQueue_ = std::make_shared<DeletionQueue>(timeline_);
+        memoryAllocator_ = std::make_shared<MemoryAllocator>(device_, memoryProperties_);
+        pipelineCache_ = std::make_shared<PipelineCache>("pipeline_cache.bin", device_, physicalDevice_);
+        samplerCache_ = std::make_shared<SamplerCache>(device_);
+        textureDescriptors_ = std::make_shared<DescriptorAllocator>(
+                device_, std::vector<VkDescriptorPoolSize>{{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1}}, 64);
+        layoutCache_ = std::make_shared<LayoutCache>(device_);
     }
 
     Context::~Context() {
         std::cout << "Destroying Vulkan context" << std::endl;
-        // 需要按照Create 的反顺序销毁
-        vkDestroySurfaceKHR(instance_, surface_, nullptr);
+        // 需要按照Create 的反顺序销毁，延迟销毁的资源释放时还需要 device，最先释放
+        deletionQueue_.reset();
+        layoutCache_.reset();
+        textureDescriptors_.reset();
+        samplerCache_.reset();
+        pipelineCache_.reset();
+        memoryAllocator_.reset();
+        transferTimeline_.reset();
+        timeline_.reset();
+        if (surface_ != VK_NULL_HANDLE) {
+            vkDestroySurfaceKHR(instance_, surface_, nullptr);
+        }
         vkDestroyDevice(device_, nullptr);
         vkDestroyInstance(instance_, nullptr);
     }
@@ -45,8 +122,9 @@ namespace render_2d {
     void Context::createInstance(const std::vector<const char *> &extensions) {
         VkInstanceCreateInfo createInfo{};
         VkApplicationInfo appInfo{};
-        // ubuntu 不支持 1.3
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // ubuntu 不支持 1.3；需要 1.2 核心的 timeline semaphore
+        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.apiVersion = VK_API_VERSION_1_2;
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
         createInfo.pApplicationInfo = &appInfo;
         createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
@@ -138,19 +216,117 @@ namespace render_2d {
         if (deviceCount == 0) {
             throw std::runtime_error("No suitable GPU found");
         }
-        for (auto device: devices) {
-            VkPhysicalDeviceFeatures features;
-            vkGetPhysicalDeviceFeatures(device, &features);
-            if (features.geometryShader) {
-                physicalDevice_ = device;
-                break;
+
+        // 指定设备：SetDeviceOverride 优先，其次是环境变量 RENDER2D_DEVICE (设备序号或 deviceUUID)
+        auto selector = deviceOverride_;
+        if (selector.empty()) {
+            if (auto env = std::getenv("RENDER2D_DEVICE")) {
+                selector = env;
+            }
+        }
+        selector.erase(std::remove(selector.begin(), selector.end(), '-'), selector.end());
+        std::transform(selector.begin(), selector.end(), selector.begin(), ::tolower);
+        bool byIndex = !selector.empty() && std::all_of(selector.begin(), selector.end(), ::isdigit);
+
+        std::optional<uint64_t> bestScore;
+        for (size_t i = 0; i < devices.size(); i++) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(devices[i], &properties);
+            auto uuid = deviceUUID(devices[i], properties);
+            auto score = rateDevice(devices[i], properties);
+            std::cout << "GPU " << i << ": " << properties.deviceName << " uuid " << uuid
+                      << (score ? " score " + std::to_string(score.value()) : " unsuitable") << std::endl;
+
+            if (!selector.empty()) {
+                bool selected = byIndex ? std::to_string(i) == selector : uuid == selector;
+                if (!selected) {
+                    continue;
+                }
+                if (!score) {
+                    throw std::runtime_error("Requested GPU " + selector + " is not suitable");
+                }
             }
+            if (score && (!bestScore || score.value() > bestScore.value())) {
+                bestScore = score;
+                physicalDevice_ = devices[i];
+            }
+        }
+        if (!bestScore) {
+            throw std::runtime_error(selector.empty() ? "No suitable GPU found"
+                                                      : "Requested GPU " + selector + " not found");
         }
         VkPhysicalDeviceProperties properties;
         vkGetPhysicalDeviceProperties(physicalDevice_, &properties);
         std::cout << "Using GPU: " << properties.deviceName << std::endl;
     }
 
+    /**
+     * 设备评分，不满足要求时返回空
+     * 必需：Vulkan 1.2 timeline semaphore、图像队列，窗口模式下还需要 present 队列和交换链拓展
+     * 评分：独显 > 集显 > 虚拟 GPU > CPU，同类型比较 device local 堆大小，有独立传输队列时加分
+     */
+    std::optional<uint64_t> Context::rateDevice(VkPhysicalDevice device, const VkPhysicalDeviceProperties &properties) {
+        if (!supportsTimelineSemaphore(device, properties)) {
+            return std::nullopt;
+        }
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+        bool graphics = false;
+        bool present = IsHeadless();
+        bool transfer = false;
+        for (uint32_t i = 0; i < queueFamilyCount; i++) {
+            auto flags = queueFamilies[i].queueFlags;
+            graphics = graphics || (flags & VK_QUEUE_GRAPHICS_BIT);
+            transfer = transfer || ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT));
+            if (!present) {
+                VkBool32 presentSupport = VK_FALSE;
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+                present = presentSupport;
+            }
+        }
+        if (!graphics || !present) {
+            return std::nullopt;
+        }
+        if (!IsHeadless() && !supportsExtension(device, VK_KHR_SWAPCHAIN_EXTENSION_NAME)) {
+            return std::nullopt;
+        }
+
+        uint64_t score = 0;
+        switch (properties.deviceType) {
+            case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+                score = 4'000'000;
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+                score = 3'000'000;
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+                score = 2'000'000;
+                break;
+            case VK_PHYSICAL_DEVICE_TYPE_CPU:
+                score = 1'000'000;
+                break;
+            default:
+                break;
+        }
+        // 最大的 device local 堆，按 MiB 计
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+        VkDeviceSize deviceLocal = 0;
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            auto &heap = memoryProperties.memoryHeaps[i];
+            if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                deviceLocal = std::max(deviceLocal, heap.size);
+            }
+        }
+        score += std::min<uint64_t>(deviceLocal >> 20, 900'000);
+        if (transfer) {
+            score += 1000;
+        }
+        return score;
+    }
+
     // 查询当前物理设备支持的队列属性
     void Context::queryQueueFamilyIndices() {
         uint32_t queueFamilyCount = 0;
@@ -159,12 +335,32 @@ namespace render_2d {
         std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
         vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice_, &queueFamilyCount, queueFamilies.data());
 
+        // 不支持图像操作的传输队列族，优先选择同时不支持计算的 (纯 DMA 队列)
+        for (uint32_t i = 0; i < queueFamilyCount; i++) {
+            auto flags = queueFamilies[i].queueFlags;
+            if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+                continue;
+            }
+            auto &transfer = queueFamilyIndices_.transferQueue;
+            if (!transfer || ((queueFamilies[transfer.value()].queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+                              !(flags & VK_QUEUE_COMPUTE_BIT))) {
+                transfer = i;
+            }
+        }
+
         for (int i = 0; i < queueFamilyCount; i++) {
             auto queueFamily = queueFamilies[i];
             // 支持图像操作的queueFamilyIndex
             if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
                 queueFamilyIndices_.graphicsQueue = i;
             }
+            // headless 模式只需要图像队列
+            if (IsHeadless()) {
+                if (queueFamilyIndices_.graphicsQueue) {
+                    break;
+                }
+                continue;
+            }
             // 查询是否支持显示
             VkBool32 presentSupport;
             vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice_,
@@ -186,7 +382,11 @@ namespace render_2d {
      * Queue  《===device_======》physicalDevice_ 传输 commandBuffer作为桥梁
      */
     void Context::createDevice() {
-        std::array extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        // headless 模式不需要交换链拓展
+        std::vector<const char *> extensions;
+        if (!IsHeadless()) {
+            extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
 
         // LogicDevice 可以设置拓展和层 extensions
         VkDeviceCreateInfo createInfo{};
@@ -194,7 +394,8 @@ namespace render_2d {
         float queuePriority = 1.0f;
 
         // only need create one queue that supports both graphics and present
-        if (queueFamilyIndices_.presentQueue.value() == queueFamilyIndices_.graphicsQueue.value()) {
+        if (!queueFamilyIndices_.presentQueue ||
+            queueFamilyIndices_.presentQueue.value() == queueFamilyIndices_.graphicsQueue.value()) {
             VkDeviceQueueCreateInfo queueCreateInfo{};
             queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
             queueCreateInfo.pQueuePriorities = &queuePriority;
@@ -219,8 +420,26 @@ namespace render_2d {
             queueCreateInfos.emplace_back(presentQueueCreateInfo);
             std::cout << "Using TWO queues for graphics and present " << std::endl;
         }
+        auto &transferFamily = queueFamilyIndices_.transferQueue;
+        if (transferFamily && transferFamily != queueFamilyIndices_.presentQueue) {
+            VkDeviceQueueCreateInfo transferQueueCreateInfo{};
+            transferQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            transferQueueCreateInfo.pQueuePriorities = &queuePriority;
+            transferQueueCreateInfo.queueCount = 1;
+            transferQueueCreateInfo.queueFamilyIndex = transferFamily.value();
+            queueCreateInfos.emplace_back(transferQueueCreateInfo);
+        }
+        if (transferFamily) {
+            std::cout << "Using dedicated transfer queue family " << transferFamily.value() << std::endl;
+        }
+
+        // pickPhysicalDevice 已经确认支持 timeline semaphore
+        VkPhysicalDeviceVulkan12Features features12{};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        features12.timelineSemaphore = VK_TRUE;
 
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = &features12;
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
@@ -237,7 +456,14 @@ namespace render_2d {
 
     void Context::getQueues() {
         vkGetDeviceQueue(device_, queueFamilyIndices_.graphicsQueue.value(), 0, &graphicsQueue_);
-        vkGetDeviceQueue(device_, queueFamilyIndices_.presentQueue.value(), 0, &presentQueue_);
+        presentQueue_ = VK_NULL_HANDLE;
+        if (queueFamilyIndices_.presentQueue) {
+            vkGetDeviceQueue(device_, queueFamilyIndices_.presentQueue.value(), 0, &presentQueue_);
+        }
+        transferQueue_ = VK_NULL_HANDLE;
+        if (queueFamilyIndices_.transferQueue) {
+            vkGetDeviceQueue(device_, queueFamilyIndices_.transferQueue.value(), 0, &transferQueue_);
+        }
     }
 
     // 初始化 Swapchain
@@ -247,6 +473,11 @@ namespace render_2d {
         swapchain_->CreateImageViews();
     }
 
+    void Context::InitOffscreenSwapChain(int width, int height, uint32_t imageCount) {
+        swapchain_ = std::make_shared<SwapChain>(width, height, imageCount);
+        swapchain_->CreateImageViews();
+    }
+
     void Context::InitRenderProcess() {
         render_process_ = std::make_shared<RenderProcess>(device_, *swapchain_, *shader_);
     }
@@ -259,13 +490,49 @@ namespace render_2d {
         commandManager_.reset();
     }
 
+    // 所有 host -> device 的数据上传都经过 UploadManager 的 staging 环形 buffer
+    void Context::InitUploadManager() {
+        UploadManager::Queue graphics{queueFamilyIndices_.graphicsQueue.value(), graphicsQueue_, timeline_};
+        std::optional<UploadManager::Queue> transfer;
+        if (transferQueue_ != VK_NULL_HANDLE) {
+            transfer = UploadManager::Queue{queueFamilyIndices_.transferQueue.value(), transferQueue_,
+                                            transferTimeline_};
+        }
+        uploadManager_ = std::make_shared<UploadManager>(8 * 1024 * 1024, graphics, transfer, device_);
+    }
+
+    void Context::QuitUploadManager() {
+        uploadManager_.reset();
+    }
+
     void Context::InitShaderModules() {
         shader_ = std::make_shared<Shader>(ReadWholeFile("../vert.spv"),
+                                           ReadWholeFile("../immediate_vert.spv"),
                                            ReadWholeFile("../frag.spv"),
-                                           device_);
+                                           device_, *layoutCache_);
     }
 
     void Context::QuitShaderModules() {
         shader_.reset();
     }
+
+    std::optional<uint32_t> Context::FindMemoryType(uint32_t memoryTypeBits,
+                                                    const MemoryPreference &preference) const {
+        std::optional<uint32_t> best;
+        int bestScore = 0;
+        for (uint32_t i = 0; i < memoryProperties_.memoryTypeCount; i++) {
+            auto flags = memoryProperties_.memoryTypes[i].propertyFlags;
+            if (!(memoryTypeBits & (1u << i)) || (flags & preference.required) != preference.required) {
+                continue;
+            }
+            // 满足一个 preferred 的权重大于避开所有 avoid，分数相同时取下标小的 (驱动按性能排序)
+            int score = 16 * static_cast<int>(std::bitset<32>(flags & preference.preferred).count()) -
+                        static_cast<int>(std::bitset<32>(flags & preference.avoid).count());
+            if (!best || score > bestScore) {
+                best = i;
+                bestScore = score;
+            }
+        }
+        return best;
+    }
 }
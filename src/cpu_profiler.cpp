@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <mutex>
+#include "../include/cpu_profiler.h"
+
+namespace render_2d {
+    namespace {
+        struct Event {
+            const char *name;
+            uint64_t startNs;
+            uint64_t durationNs;
+        };
+
+        struct ThreadBuffer {
+            uint32_t tid;
+            std::atomic<uint64_t> written{0};
+            std::array<Event, CpuProfiler::kThreadCapacity> events;
+        };
+
+        // 线程退出后 buffer 仍保留在注册表中，之后还可以导出
+        std::mutex registryMutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> registry;
+
+        ThreadBuffer &threadBuffer() {
+            thread_local std::shared_ptr<ThreadBuffer> buffer;
+            if (!buffer) {
+                buffer = std::make_shared<ThreadBuffer>();
+                std::lock_guard<std::mutex> lock(registryMutex);
+                buffer->tid = static_cast<uint32_t>(registry.size());
+                registry.push_back(buffer);
+            }
+            return *buffer;
+        }
+    }
+
+    void CpuProfiler::Record(const char *name, uint64_t startNs, uint64_t endNs) {
+        auto &buffer = threadBuffer();
+        auto index = buffer.written.load(std::memory_order_relaxed);
+        buffer.events[index % kThreadCapacity] = Event{name, startNs, endNs - startNs};
+        buffer.written.store(index + 1, std::memory_order_release);
+    }
+
+    bool CpuProfiler::WriteChromeTrace(const std::string &path) {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file) {
+            std::cerr << "CpuProfiler failed to open trace file " << path << std::endl;
+            return false;
+        }
+        // ts / dur 单位为微秒
+        file << "{\"traceEvents\":[";
+        bool first = true;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto &buffer: registry) {
+            auto written = buffer->written.load(std::memory_order_acquire);
+            auto begin = written > kThreadCapacity ? written - kThreadCapacity : 0;
+            for (auto i = begin; i < written; i++) {
+                auto &event = buffer->events[i % kThreadCapacity];
+                file << (first ? "" : ",") << "\n{\"name\":\"" << event.name << "\",\"cat\":\"cpu\",\"ph\":\"X\""
+                     << ",\"pid\":0,\"tid\":" << buffer->tid << ",\"ts\":" << std::fixed << event.startNs / 1000.0
+                     << ",\"dur\":" << event.durationNs / 1000.0 << "}";
+                first = false;
+            }
+        }
+        file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        return static_cast<bool>(file);
+    }
+
+    void FrameStats::AddFrame(double ms) {
+        frames_.push_back(ms);
+        if (frames_.size() > windowSize_) {
+            frames_.pop_front();
+        }
+    }
+
+    FrameStats::Percentiles FrameStats::GetPercentiles() const {
+        Percentiles result{};
+        if (frames_.empty()) {
+            return result;
+        }
+        std::vector<double> sorted(frames_.begin(), frames_.end());
+        std::sort(sorted.begin(), sorted.end());
+        auto at = [&sorted](size_t percent) {
+            return sorted[std::min(sorted.size() - 1, sorted.size() * percent / 100)];
+        };
+        result.p50Ms = at(50);
+        result.p95Ms = at(95);
+        result.p99Ms = at(99);
+        result.maxMs = sorted.back();
+        result.samples = sorted.size();
+        return result;
+    }
+}
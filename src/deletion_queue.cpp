@@ -0,0 +1,66 @@
+#include <algorithm>
+#include "../include/deletion_queue.h"
+
+namespace render_2d {
+    DeletionQueue::DeletionQueue(std::shared_ptr<Timeline> timeline) : timeline_(std::move(timeline)) {}
+
+    DeletionQueue::~DeletionQueue() {
+        timeline_->WaitIdle();
+        for (auto &entry: entries_) {
+            entry.deleter();
+        }
+        for (auto &deleter: unsealed_) {
+            deleter();
+        }
+        for (auto &delayed: delayed_) {
+            delayed.deleter();
+        }
+    }
+
+    void DeletionQueue::Push(Deleter deleter) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        unsealed_.push_back(std::move(deleter));
+    }
+
+    void DeletionQueue::Push(uint64_t value, Deleter deleter) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.push_back(Entry{value, std::move(deleter)});
+    }
+
+    void DeletionQueue::PushAfterFrames(uint32_t frames, Deleter deleter) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        delayed_.push_back(Delayed{std::max(frames, 1u), std::move(deleter)});
+    }
+
+    void DeletionQueue::Seal(uint64_t value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &deleter: unsealed_) {
+            entries_.push_back(Entry{value, std::move(deleter)});
+        }
+        unsealed_.clear();
+        auto it = std::stable_partition(delayed_.begin(), delayed_.end(), [](Delayed &delayed) {
+            return --delayed.frames > 0;
+        });
+        for (auto retired = it; retired != delayed_.end(); ++retired) {
+            entries_.push_back(Entry{value, std::move(retired->deleter)});
+        }
+        delayed_.erase(it, delayed_.end());
+    }
+
+    void DeletionQueue::Collect() {
+        std::vector<Entry> retired;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto completed = timeline_->Completed();
+            auto it = std::stable_partition(entries_.begin(), entries_.end(), [completed](const Entry &entry) {
+                return entry.value > completed;
+            });
+            std::move(it, entries_.end(), std::back_inserter(retired));
+            entries_.erase(it, entries_.end());
+        }
+        // deleter 中可能析构其它资源而再次 Push，不能持有锁执行
+        for (auto &entry: retired) {
+            entry.deleter();
+        }
+    }
+}
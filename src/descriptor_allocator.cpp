@@ -0,0 +1,84 @@
+#include <algorithm>
+#include "../include/descriptor_allocator.h"
+
+namespace render_2d {
+    // 单个池的 maxSets 上限，到达后新池不再翻倍
+    constexpr uint32_t kMaxPoolSets = 4096;
+
+    DescriptorAllocator::DescriptorAllocator(VkDevice device, std::vector<VkDescriptorPoolSize> setSizes,
+                                             uint32_t initialSets)
+            : setSizes_(std::move(setSizes)), initialSets_(initialSets), device_(device) {}
+
+    DescriptorAllocator::~DescriptorAllocator() {
+        for (auto &pool: pools_) {
+            vkDestroyDescriptorPool(device_, pool.pool, nullptr);
+        }
+    }
+
+    DescriptorAllocator::Allocation DescriptorAllocator::Allocate(VkDescriptorSetLayout layout) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        VkDescriptorSetAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = &layout;
+
+        // 从最新 (最大) 的池开始找，满了的池直接跳过
+        for (auto it = pools_.rbegin(); it != pools_.rend(); ++it) {
+            if (it->allocated >= it->maxSets) {
+                continue;
+            }
+            allocateInfo.descriptorPool = it->pool;
+            VkDescriptorSet set;
+            auto res = vkAllocateDescriptorSets(device_, &allocateInfo, &set);
+            if (res == VK_SUCCESS) {
+                it->allocated++;
+                return {it->pool, set};
+            }
+            // 池的碎片或某类描述符用完时换下一个池，其他错误直接失败
+            if (res != VK_ERROR_OUT_OF_POOL_MEMORY && res != VK_ERROR_FRAGMENTED_POOL) {
+                throw std::runtime_error("DescriptorAllocator failed to allocate descriptor set");
+            }
+        }
+
+        auto &pool = createPool();
+        allocateInfo.descriptorPool = pool.pool;
+        VkDescriptorSet set;
+        if (vkAllocateDescriptorSets(device_, &allocateInfo, &set) != VK_SUCCESS) {
+            throw std::runtime_error("DescriptorAllocator failed to allocate descriptor set");
+        }
+        pool.allocated++;
+        return {pool.pool, set};
+    }
+
+    void DescriptorAllocator::Free(const Allocation &allocation) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &pool: pools_) {
+            if (pool.pool == allocation.pool) {
+                vkFreeDescriptorSets(device_, pool.pool, 1, &allocation.set);
+                pool.allocated--;
+                return;
+            }
+        }
+        assert(false && "descriptor set was not allocated by this allocator");
+    }
+
+    DescriptorAllocator::Pool &DescriptorAllocator::createPool() {
+        uint32_t maxSets = pools_.empty() ? initialSets_ : std::min(pools_.back().maxSets * 2, kMaxPoolSets);
+        std::vector<VkDescriptorPoolSize> poolSizes = setSizes_;
+        for (auto &poolSize: poolSizes) {
+            poolSize.descriptorCount *= maxSets;
+        }
+        VkDescriptorPoolCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+        createInfo.maxSets = maxSets;
+        createInfo.poolSizeCount = poolSizes.size();
+        createInfo.pPoolSizes = poolSizes.data();
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(device_, &createInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("DescriptorAllocator failed to create descriptor pool");
+        }
+        pools_.push_back(Pool{pool, maxSets, 0});
+        return pools_.back();
+    }
+}
@@ -0,0 +1,115 @@
+#include "../include/font.h"
+
+namespace render_2d {
+    // 排版缓存的上限，超过后整体清空 (UI 文本大多每帧重复，清空后很快重新填满)
+    constexpr size_t kMaxCachedLayouts = 4096;
+
+    // 解码一个 UTF-8 字符，非法序列返回 U+FFFD 并前进一个字节
+    static uint32_t decodeUtf8(const std::string &text, size_t &i) {
+        auto c = static_cast<uint8_t>(text[i]);
+        int length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+        if (length == 0 || i + length > text.size()) {
+            i++;
+            return 0xFFFD;
+        }
+        uint32_t codepoint = length == 1 ? c : c & (0xFF >> (length + 1));
+        for (int k = 1; k < length; k++) {
+            auto next = static_cast<uint8_t>(text[i + k]);
+            if ((next & 0xC0) != 0x80) {
+                i++;
+                return 0xFFFD;
+            }
+            codepoint = (codepoint << 6) | (next & 0x3F);
+        }
+        i += length;
+        return codepoint;
+    }
+
+    Font::Font(const std::string &path, float rasterHeight)
+            : data_(ReadWholeFile(path)), rasterHeight_(rasterHeight), atlas_(1024, VK_FILTER_LINEAR, 1) {
+        auto data = reinterpret_cast<const unsigned char *>(data_.data());
+        if (!stbtt_InitFont(&info_, data, stbtt_GetFontOffsetForIndex(data, 0))) {
+            throw std::runtime_error("Font failed to parse " + path);
+        }
+        scale_ = stbtt_ScaleForPixelHeight(&info_, rasterHeight_);
+        int ascent, descent, lineGap;
+        stbtt_GetFontVMetrics(&info_, &ascent, &descent, &lineGap);
+        ascent_ = ascent * scale_;
+        lineHeight_ = (ascent - descent + lineGap) * scale_;
+        std::cout << "Font loaded " << path << " raster height " << rasterHeight_ << std::endl;
+    }
+
+    Font::~Font() {
+        layouts_.clear();
+        glyphs_.clear();
+    }
+
+    const Font::TextLayout &Font::Layout(const std::string &text) {
+        auto it = layouts_.find(text);
+        if (it != layouts_.end()) {
+            return it->second;
+        }
+        if (layouts_.size() >= kMaxCachedLayouts) {
+            layouts_.clear();
+        }
+
+        TextLayout layout{};
+        glm::vec2 pen(0.0f, 0.0f);
+        uint32_t prev = 0;
+        for (size_t i = 0; i < text.size();) {
+            auto codepoint = decodeUtf8(text, i);
+            if (codepoint == '\n') {
+                layout.size.x = std::max(layout.size.x, pen.x);
+                pen = glm::vec2(0.0f, pen.y + lineHeight_);
+                prev = 0;
+                continue;
+            }
+            if (prev) {
+                pen.x += stbtt_GetCodepointKernAdvance(&info_, static_cast<int>(prev), static_cast<int>(codepoint)) *
+                         scale_;
+            }
+            auto &glyph = getGlyph(codepoint);
+            if (glyph.region) {
+                layout.quads.push_back(GlyphQuad{pen + glyph.bearing,
+                                                 glm::vec2(glyph.region->width, glyph.region->height),
+                                                 glyph.region->texture, glyph.region->uvRect});
+            }
+            pen.x += glyph.advance;
+            prev = codepoint;
+        }
+        layout.size.x = std::max(layout.size.x, pen.x);
+        layout.size.y = pen.y + lineHeight_;
+        return layouts_.emplace(text, std::move(layout)).first->second;
+    }
+
+    // 第一次使用时光栅化，8位覆盖率转换为白色 + alpha，颜色由绘制时的 tint 决定
+    const Font::Glyph &Font::getGlyph(uint32_t codepoint) {
+        auto it = glyphs_.find(codepoint);
+        if (it != glyphs_.end()) {
+            return it->second;
+        }
+
+        Glyph glyph{};
+        int advance, leftSideBearing;
+        stbtt_GetCodepointHMetrics(&info_, static_cast<int>(codepoint), &advance, &leftSideBearing);
+        glyph.advance = advance * scale_;
+
+        int x0, y0, x1, y1;
+        stbtt_GetCodepointBitmapBox(&info_, static_cast<int>(codepoint), scale_, scale_, &x0, &y0, &x1, &y1);
+        int width = x1 - x0;
+        int height = y1 - y0;
+        if (width > 0 && height > 0) {
+            std::vector<uint8_t> coverage(static_cast<size_t>(width) * height);
+            stbtt_MakeCodepointBitmap(&info_, coverage.data(), width, height, width, scale_, scale_,
+                                      static_cast<int>(codepoint));
+            std::vector<uint32_t> pixels(coverage.size());
+            for (size_t i = 0; i < coverage.size(); i++) {
+                pixels[i] = 0x00FFFFFFu | (static_cast<uint32_t>(coverage[i]) << 24);
+            }
+            glyph.region = atlas_.Add(width, height, pixels.data());
+            // y0 为位图顶部相对于基线的偏移 (向下为正)
+            glyph.bearing = glm::vec2(x0, y0);
+        }
+        return glyphs_.emplace(codepoint, glyph).first->second;
+    }
+}
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <numeric>
+#include "../include/gpu_profiler.h"
+
+namespace render_2d {
+    GpuProfiler::GpuProfiler(uint32_t frameCount, uint32_t queueFamilyIndex, VkPhysicalDevice physicalDevice,
+                             VkDevice device) : device_(device) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        periodNs_ = properties.limits.timestampPeriod;
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+        auto validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+        validMask_ = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+        supported_ = validBits > 0;
+        if (!supported_) {
+            std::cerr << "GpuProfiler: queue family does not support timestamps, profiling disabled" << std::endl;
+            return;
+        }
+
+        frames_.resize(frameCount);
+        for (auto &frame: frames_) {
+            VkQueryPoolCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            createInfo.queryCount = kMaxScopes * 2;
+            if (vkCreateQueryPool(device_, &createInfo, nullptr, &frame.pool) != VK_SUCCESS) {
+                throw std::runtime_error("GpuProfiler failed to create query pool");
+            }
+            // 新建的 query 处于未定义状态，第一次使用前也需要重置
+            frame.needsReset = true;
+            frame.frameIndex = 0;
+        }
+    }
+
+    GpuProfiler::~GpuProfiler() {
+        for (auto &frame: frames_) {
+            vkDestroyQueryPool(device_, frame.pool, nullptr);
+        }
+    }
+
+    void GpuProfiler::BeginFrame(uint32_t frame) {
+        if (!supported_) {
+            return;
+        }
+        current_ = &frames_[frame];
+        collect(*current_);
+        current_->scopes.clear();
+        current_->needsReset = true;
+        current_->frameIndex = ++frameCounter_;
+    }
+
+    int GpuProfiler::Begin(VkCommandBuffer cmd, const std::string &name) {
+        if (!IsEnabled() || !current_ || current_->scopes.size() >= kMaxScopes) {
+            return -1;
+        }
+        // 重置录制在该帧第一个写时间戳的 commandBuffer 中 (render pass 之外)，同一队列上与之后的写入按提交顺序执行
+        if (current_->needsReset) {
+            vkCmdResetQueryPool(cmd, current_->pool, 0, kMaxScopes * 2);
+            current_->needsReset = false;
+        }
+        auto query = static_cast<uint32_t>(current_->scopes.size() * 2);
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, current_->pool, query);
+        current_->scopes.push_back(Scope{name, query});
+        return static_cast<int>(current_->scopes.size() - 1);
+    }
+
+    void GpuProfiler::End(VkCommandBuffer cmd, int scope) {
+        if (scope < 0 || !current_ || static_cast<size_t>(scope) >= current_->scopes.size()) {
+            return;
+        }
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current_->pool,
+                            current_->scopes[scope].beginQuery + 1);
+    }
+
+    // 不等待结果：没有写入 (如 End 缺失) 或尚未完成的区间直接丢弃
+    void GpuProfiler::collect(FrameQueries &frame) {
+        if (frame.scopes.empty()) {
+            return;
+        }
+        // 每个 query 两个值：时间戳和可用标记
+        auto queryCount = static_cast<uint32_t>(frame.scopes.size() * 2);
+        std::vector<uint64_t> results(queryCount * 2);
+        auto res = vkGetQueryPoolResults(device_, frame.pool, 0, queryCount, results.size() * sizeof(uint64_t),
+                                         results.data(), 2 * sizeof(uint64_t),
+                                         VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (res != VK_SUCCESS && res != VK_NOT_READY) {
+            return;
+        }
+
+        std::map<std::string, double> frameTotals;
+        for (size_t i = 0; i < frame.scopes.size(); i++) {
+            auto begin = frame.scopes[i].beginQuery;
+            if (!results[begin * 2 + 1] || !results[(begin + 1) * 2 + 1]) {
+                continue;
+            }
+            auto startTicks = results[begin * 2] & validMask_;
+            auto endTicks = results[(begin + 1) * 2] & validMask_;
+            auto ticks = (endTicks - startTicks) & validMask_; // 计数器回绕
+            auto durationUs = static_cast<double>(ticks) * periodNs_ / 1000.0;
+            frameTotals[frame.scopes[i].name] += durationUs / 1000.0;
+            trace_.push_back(TraceEvent{frame.scopes[i].name, frame.frameIndex,
+                                        static_cast<double>(startTicks) * periodNs_ / 1000.0, durationUs});
+        }
+
+        for (auto &[name, ms]: frameTotals) {
+            auto &history = history_[name];
+            history.push_back(ms);
+            if (history.size() > kWindowFrames) {
+                history.pop_front();
+            }
+        }
+        while (!trace_.empty() && trace_.front().frameIndex + kWindowFrames <= frame.frameIndex) {
+            trace_.pop_front();
+        }
+    }
+
+    std::map<std::string, GpuProfiler::Stats> GpuProfiler::GetStats() const {
+        std::map<std::string, Stats> stats;
+        for (auto &[name, history]: history_) {
+            if (history.empty()) {
+                continue;
+            }
+            std::vector<double> sorted(history.begin(), history.end());
+            std::sort(sorted.begin(), sorted.end());
+            Stats entry{};
+            entry.lastMs = history.back();
+            entry.minMs = sorted.front();
+            entry.avgMs = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+            entry.p99Ms = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+            entry.samples = sorted.size();
+            stats[name] = entry;
+        }
+        return stats;
+    }
+
+    void GpuProfiler::ResetStats() {
+        history_.clear();
+        trace_.clear();
+    }
+
+    bool GpuProfiler::WriteChromeTrace(const std::string &path) const {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file) {
+            std::cerr << "GpuProfiler failed to open trace file " << path << std::endl;
+            return false;
+        }
+        // 同一帧的区间放在同一个 tid 下会互相嵌套显示，ts / dur 单位为微秒
+        file << "{\"traceEvents\":[";
+        bool first = true;
+        for (auto &event: trace_) {
+            file << (first ? "" : ",") << "\n{\"name\":\"" << event.name << "\",\"cat\":\"gpu\",\"ph\":\"X\""
+                 << ",\"pid\":0,\"tid\":0,\"ts\":" << std::fixed << event.startUs
+                 << ",\"dur\":" << event.durationUs << ",\"args\":{\"frame\":" << event.frameIndex << "}}";
+            first = false;
+        }
+        file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        return static_cast<bool>(file);
+    }
+}
@@ -0,0 +1,91 @@
+#include "../include/layout_cache.h"
+
+namespace render_2d {
+    LayoutCache::LayoutCache(VkDevice device) : device_(device) {}
+
+    LayoutCache::~LayoutCache() {
+        for (auto &[key, layout]: pipelineLayouts_) {
+            vkDestroyPipelineLayout(device_, layout, nullptr);
+        }
+        for (auto &[key, layout]: setLayouts_) {
+            vkDestroyDescriptorSetLayout(device_, layout, nullptr);
+        }
+    }
+
+    // FNV-1a
+    size_t LayoutCache::KeyHash::operator()(const Key &key) const {
+        uint64_t hash = 14695981039346656037ull;
+        for (auto word: key) {
+            hash ^= word;
+            hash *= 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+
+    VkDescriptorSetLayout LayoutCache::GetSetLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings) {
+        Key key;
+        for (auto &binding: bindings) {
+            assert(binding.pImmutableSamplers == nullptr);
+            key.insert(key.end(), {binding.binding, static_cast<uint64_t>(binding.descriptorType),
+                                   binding.descriptorCount, binding.stageFlags});
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = setLayouts_.find(key);
+        if (it != setLayouts_.end()) {
+            return it->second;
+        }
+
+        VkDescriptorSetLayoutCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        createInfo.bindingCount = bindings.size();
+        createInfo.pBindings = bindings.data();
+        VkDescriptorSetLayout layout;
+        if (vkCreateDescriptorSetLayout(device_, &createInfo, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("LayoutCache failed to create descriptor set layout");
+        }
+        setLayouts_.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    VkPipelineLayout LayoutCache::GetPipelineLayout(const std::vector<VkDescriptorSetLayout> &setLayouts,
+                                                    const std::vector<VkPushConstantRange> &pushConstants) {
+        // set 布局已经去重，比较句柄即可
+        Key key;
+        key.push_back(setLayouts.size());
+        for (auto setLayout: setLayouts) {
+            key.push_back(reinterpret_cast<uint64_t>(setLayout));
+        }
+        for (auto &range: pushConstants) {
+            key.insert(key.end(), {range.stageFlags, range.offset, range.size});
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pipelineLayouts_.find(key);
+        if (it != pipelineLayouts_.end()) {
+            return it->second;
+        }
+
+        VkPipelineLayoutCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        createInfo.setLayoutCount = setLayouts.size();
+        createInfo.pSetLayouts = setLayouts.data();
+        createInfo.pushConstantRangeCount = pushConstants.size();
+        createInfo.pPushConstantRanges = pushConstants.data();
+        VkPipelineLayout layout;
+        if (vkCreatePipelineLayout(device_, &createInfo, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("LayoutCache failed to create pipeline layout");
+        }
+        pipelineLayouts_.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    LayoutCache::PipelineLayout LayoutCache::Get(const ShaderReflection &reflection) {
+        PipelineLayout result{};
+        for (auto &bindings: reflection.GetSetLayoutBindings()) {
+            result.setLayouts.push_back(GetSetLayout(bindings));
+        }
+        result.layout = GetPipelineLayout(result.setLayouts, reflection.pushConstants);
+        return result;
+    }
+}
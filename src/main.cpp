@@ -46,12 +46,29 @@ void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods
             case GLFW_KEY_RIGHT:
                 x += 10;
                 break;
+            case GLFW_KEY_P:
+                // 导出最近的 GPU 区间，可在 chrome://tracing 或 Perfetto 中查看
+                render_2d::GetRenderer()->GetGpuProfiler().WriteChromeTrace("gpu_trace.json");
+                break;
+            case GLFW_KEY_C:
+                // 导出各线程最近的 CPU 区间
+                render_2d::CpuProfiler::WriteChromeTrace("cpu_trace.json");
+                break;
             default:
                 break;
         }
     }
 }
 
+// 窗口尺寸变化：重建交换链并更新正交投影，保持一个像素对应一个单位
+void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+    auto renderer = render_2d::GetRenderer();
+    renderer->Resize(width, height);
+    if (width > 0 && height > 0) {
+        renderer->SetProjectMat(width, 0, 0, height, -1, 1);
+    }
+}
+
 int main(void) {
     /* Initialize the library */
     if (!glfwInit())
@@ -66,9 +83,6 @@ int main(void) {
         return -1;
     }
 
-    int frame_count = 0;
-    std::chrono::high_resolution_clock::time_point last_frame_time = std::chrono::high_resolution_clock::now();
-
     /* 获得GLFW 所支持的拓展个数 */
     uint32_t extensionCount = 0;
     const char **extensions = glfwGetRequiredInstanceExtensions(&extensionCount);
@@ -94,10 +108,18 @@ int main(void) {
 
     /* 注册键盘事件处理函数 */
     glfwSetKeyCallback(window, keyCallback);
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+
+    // 单看 FPS 会掩盖偶发的长帧，统计最近若干帧的帧时间分位数
+    render_2d::FrameStats frameTimes;
+    std::chrono::steady_clock::time_point last_frame_time = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point last_print_time = last_frame_time;
 
     /* Loop until the user closes the window */
     while (!glfwWindowShouldClose(window)) {
-        std::chrono::high_resolution_clock::time_point current_frame_time = std::chrono::high_resolution_clock::now();
+        std::chrono::steady_clock::time_point current_frame_time = std::chrono::steady_clock::now();
+        frameTimes.AddFrame(std::chrono::duration<double, std::milli>(current_frame_time - last_frame_time).count());
+        last_frame_time = current_frame_time;
 
         /* Swap front and back buffers */
         glfwSwapBuffers(window);
@@ -105,21 +127,38 @@ int main(void) {
         /* Poll for and process events */
         glfwPollEvents();
 
+        /* Draw : 一帧内的所有 DrawRect 会合并为一次提交 */
+        renderer->BeginFrame();
+
         /* 根据键盘数字输入改变颜色*/
         // 接收数字1：
         renderer->SetDrawColor(currentColor);
+        renderer->DrawRect(render_2d::Rect{glm::vec2(x, y), glm::vec2(200, 300)});
 
+        // 光标位置的小方块，每帧位置都变，走 push constant 立即绘制
+        double cursorX, cursorY;
+        glfwGetCursorPos(window, &cursorX, &cursorY);
+        renderer->DrawRectImmediate(render_2d::Rect{glm::vec2(cursorX, cursorY), glm::vec2(12, 12)},
+                                    render_2d::Color{0.0f, 0.0f, 0.0f, 0.8f});
 
-        /* Draw */
-        renderer->DrawRect(render_2d::Rect{glm::vec2(x, y), glm::vec2(200, 300)});
+        renderer->EndFrame();
 
-        // 更新FPS计数  
-        frame_count++;
-        auto duration = std::chrono::duration_cast<std::chrono::seconds>(current_frame_time - last_frame_time).count();
+        // 每秒输出一次帧时间分布
+        auto duration = std::chrono::duration_cast<std::chrono::seconds>(current_frame_time - last_print_time).count();
         if (duration >= 1) {
-            std::cout << "DrawRect FPS: " << frame_count << std::endl;
-            frame_count = 0; // 重置FPS计数  
-            last_frame_time = current_frame_time; // 更新上一次时间戳  
+            auto cpuStats = frameTimes.GetPercentiles();
+            std::cout << std::fixed << std::setprecision(3) << "Frame time p50 " << cpuStats.p50Ms
+                      << " ms, p95 " << cpuStats.p95Ms << " ms, p99 " << cpuStats.p99Ms
+                      << " ms, max " << cpuStats.maxMs << " ms";
+            // GPU 耗时 (若干帧之前的结果，不阻塞)
+            auto gpuStats = renderer->GetGpuProfiler().GetStats();
+            auto frameStats = gpuStats.find("frame");
+            if (frameStats != gpuStats.end()) {
+                std::cout << "  GPU frame avg " << frameStats->second.avgMs
+                          << " ms, p99 " << frameStats->second.p99Ms << " ms";
+            }
+            std::cout << std::endl;
+            last_print_time = current_frame_time;
         }
     }
 
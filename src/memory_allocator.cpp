@@ -0,0 +1,256 @@
+#include <algorithm>
+#include "../include/memory_allocator.h"
+
+namespace render_2d {
+    // buddy 最小块，小于该大小的请求按该大小分配
+    constexpr VkDeviceSize kMinBlockSize = 256;
+
+    constexpr VkDeviceSize kDefaultPageSize = 64ull * 1024 * 1024;
+
+    constexpr VkDeviceSize kMinPageSize = 1024 * 1024;
+
+    static VkDeviceSize blockSize(uint32_t order) {
+        return kMinBlockSize << order;
+    }
+
+    static uint32_t orderOf(VkDeviceSize size) {
+        uint32_t order = 0;
+        while (blockSize(order) < size) {
+            order++;
+        }
+        return order;
+    }
+
+    MemoryPreference MemoryPreference::GpuOnly() {
+        return {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT};
+    }
+
+    MemoryPreference MemoryPreference::Streaming() {
+        // CPU 顺序写入，write-combined 比 cached 更快
+        return {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                VK_MEMORY_PROPERTY_HOST_CACHED_BIT};
+    }
+
+    MemoryPreference MemoryPreference::Staging() {
+        return {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT};
+    }
+
+    MemoryPreference MemoryPreference::Readback() {
+        // 非 coherent 的 cached 内存读取前需要 invalidate
+        return {VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+    }
+
+    MemoryAllocator::MemoryAllocator(VkDevice device, const VkPhysicalDeviceMemoryProperties &memoryProperties)
+            : device_(device), memoryProperties_(memoryProperties) {
+        std::cout << "MemoryAllocator created, memory type count -> " << memoryProperties_.memoryTypeCount
+                  << std::endl;
+    }
+
+    MemoryAllocator::~MemoryAllocator() {
+        if (stats_.usedBytes != 0) {
+            std::cerr << "MemoryAllocator destroyed with " << stats_.usedBytes << " bytes still allocated"
+                      << std::endl;
+        }
+        for (auto &page: pages_) {
+            if (page) {
+                freeDeviceMemory(page->memory, pageSizeFor(page->memoryTypeIndex), page->mapped);
+            }
+        }
+        std::cout << "MemoryAllocator destroyed, peak used bytes -> " << stats_.peakUsedBytes << std::endl;
+    }
+
+    MemoryAllocator::Allocation MemoryAllocator::Allocate(const VkMemoryRequirements &requirements,
+                                                          uint32_t memoryTypeIndex, ResourceKind kind) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Allocation allocation{};
+        allocation.memoryTypeIndex = memoryTypeIndex;
+
+        // buddy 块的偏移是块大小的整数倍，块大小不小于 alignment 即可满足对齐要求
+        auto order = orderOf(std::max(requirements.size, requirements.alignment));
+        auto pageSize = pageSizeFor(memoryTypeIndex);
+
+        if (blockSize(order) > pageSize / 2) {
+            // 大资源单独分配，避免一个资源占满整页
+            allocation.memory = allocateDeviceMemory(requirements.size, memoryTypeIndex, &allocation.mapped);
+            allocation.size = requirements.size;
+            allocation.dedicated = true;
+            stats_.usedBytes += allocation.size;
+            stats_.peakUsedBytes = std::max(stats_.peakUsedBytes, stats_.usedBytes);
+            return allocation;
+        }
+
+        VkDeviceSize offset = 0;
+        uint32_t pageIndex = 0;
+        bool found = false;
+        for (; pageIndex < pages_.size(); pageIndex++) {
+            auto &page = pages_[pageIndex];
+            if (page && page->memoryTypeIndex == memoryTypeIndex && page->kind == kind &&
+                allocateFromPage(*page, order, offset)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            pageIndex = createPage(memoryTypeIndex, kind);
+            allocateFromPage(*pages_[pageIndex], order, offset);
+        }
+
+        auto &page = pages_[pageIndex];
+        allocation.memory = page->memory;
+        allocation.offset = offset;
+        allocation.size = requirements.size;
+        allocation.mapped = page->mapped ? static_cast<char *>(page->mapped) + offset : nullptr;
+        allocation.page = pageIndex;
+        allocation.order = order;
+        stats_.usedBytes += blockSize(order);
+        stats_.peakUsedBytes = std::max(stats_.peakUsedBytes, stats_.usedBytes);
+        return allocation;
+    }
+
+    void MemoryAllocator::Free(const Allocation &allocation) {
+        if (allocation.memory == VK_NULL_HANDLE) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (allocation.dedicated) {
+            freeDeviceMemory(allocation.memory, allocation.size, allocation.mapped);
+            stats_.usedBytes -= allocation.size;
+            return;
+        }
+
+        auto &page = pages_[allocation.page];
+        auto offset = allocation.offset;
+        auto order = allocation.order;
+        page->usedBytes -= blockSize(order);
+        stats_.usedBytes -= blockSize(order);
+
+        // 与 buddy 块合并，直到 buddy 不空闲或者合并为整页
+        while (order + 1 < page->freeLists.size()) {
+            auto buddy = offset ^ blockSize(order);
+            auto it = page->freeLists[order].find(buddy);
+            if (it == page->freeLists[order].end()) {
+                break;
+            }
+            page->freeLists[order].erase(it);
+            offset = std::min(offset, buddy);
+            order++;
+        }
+        page->freeLists[order].insert(offset);
+
+        if (page->usedBytes == 0) {
+            releasePageIfSpare(allocation.page);
+        }
+    }
+
+    VkMappedMemoryRange MemoryAllocator::GetMappedRange(const Allocation &allocation) const {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = allocation.memory;
+        // buddy 块按块大小 (>= 256) 对齐，nonCoherentAtomSize 最大为 256，整块 flush 即可满足对齐
+        range.offset = allocation.offset;
+        range.size = allocation.dedicated ? VK_WHOLE_SIZE : blockSize(allocation.order);
+        return range;
+    }
+
+    MemoryAllocator::Stats MemoryAllocator::GetStats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    VkDeviceMemory MemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void **mapped) {
+        VkMemoryAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.allocationSize = size;
+        allocateInfo.memoryTypeIndex = memoryTypeIndex;
+        VkDeviceMemory memory;
+        auto res = vkAllocateMemory(device_, &allocateInfo, nullptr, &memory);
+        if (res != VK_SUCCESS) {
+            throw std::runtime_error("MemoryAllocator vkAllocateMemory failed res: " + std::to_string(res));
+        }
+
+        // host可见内存整块持久映射，同一个 VkDeviceMemory 不能重复 map
+        *mapped = nullptr;
+        if (memoryProperties_.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+        }
+
+        stats_.deviceMemoryCount++;
+        stats_.reservedBytes += size;
+        return memory;
+    }
+
+    void MemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, VkDeviceSize size, void *mapped) {
+        if (mapped) {
+            vkUnmapMemory(device_, memory);
+        }
+        vkFreeMemory(device_, memory, nullptr);
+        stats_.deviceMemoryCount--;
+        stats_.reservedBytes -= size;
+    }
+
+    // 默认 64MB 一页，小的 heap (如 256MB 的 BAR) 按 heap 的 1/8 缩小
+    VkDeviceSize MemoryAllocator::pageSizeFor(uint32_t memoryTypeIndex) const {
+        auto heapIndex = memoryProperties_.memoryTypes[memoryTypeIndex].heapIndex;
+        auto heapSize = memoryProperties_.memoryHeaps[heapIndex].size;
+        auto size = kDefaultPageSize;
+        while (size > kMinPageSize && size > heapSize / 8) {
+            size /= 2;
+        }
+        return size;
+    }
+
+    uint32_t MemoryAllocator::createPage(uint32_t memoryTypeIndex, ResourceKind kind) {
+        auto pageSize = pageSizeFor(memoryTypeIndex);
+        auto page = std::make_unique<Page>();
+        page->memoryTypeIndex = memoryTypeIndex;
+        page->kind = kind;
+        page->memory = allocateDeviceMemory(pageSize, memoryTypeIndex, &page->mapped);
+        page->freeLists.resize(orderOf(pageSize) + 1);
+        page->freeLists.back().insert(0);
+
+        for (uint32_t i = 0; i < pages_.size(); i++) {
+            if (!pages_[i]) {
+                pages_[i] = std::move(page);
+                return i;
+            }
+        }
+        pages_.push_back(std::move(page));
+        return pages_.size() - 1;
+    }
+
+    bool MemoryAllocator::allocateFromPage(Page &page, uint32_t order, VkDeviceSize &offset) {
+        auto current = order;
+        while (current < page.freeLists.size() && page.freeLists[current].empty()) {
+            current++;
+        }
+        if (current == page.freeLists.size()) {
+            return false;
+        }
+
+        offset = *page.freeLists[current].begin();
+        page.freeLists[current].erase(page.freeLists[current].begin());
+        // 大块对半拆分，后半部分放回低一阶的空闲链表
+        while (current > order) {
+            current--;
+            page.freeLists[current].insert(offset + blockSize(current));
+        }
+        page.usedBytes += blockSize(order);
+        return true;
+    }
+
+    // 同一 (内存类型, 资源类型) 的空页只保留一个，避免反复 vkAllocateMemory / vkFreeMemory
+    void MemoryAllocator::releasePageIfSpare(uint32_t pageIndex) {
+        auto &page = pages_[pageIndex];
+        for (uint32_t i = 0; i < pages_.size(); i++) {
+            if (i != pageIndex && pages_[i] && pages_[i]->memoryTypeIndex == page->memoryTypeIndex &&
+                pages_[i]->kind == page->kind && pages_[i]->usedBytes == 0) {
+                freeDeviceMemory(page->memory, pageSizeFor(page->memoryTypeIndex), page->mapped);
+                page.reset();
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#include <filesystem>
+#include "../include/pipeline_cache.h"
+
+namespace render_2d {
+    PipelineCache::PipelineCache(const std::string &path, VkDevice device, VkPhysicalDevice gpu)
+            : path_(path), device_(device) {
+        vkGetPhysicalDeviceProperties(gpu, &properties_);
+
+        std::string data;
+        if (std::filesystem::exists(path_)) {
+            try {
+                data = ReadWholeFile(path_);
+            } catch (const std::exception &e) {
+                data.clear();
+            }
+            if (!validateHeader(data)) {
+                std::cerr << "PipelineCache discard incompatible cache file: " << path_ << std::endl;
+                data.clear();
+            }
+        }
+
+        VkPipelineCacheCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.initialDataSize = data.size();
+        createInfo.pInitialData = data.empty() ? nullptr : data.data();
+        if (vkCreatePipelineCache(device_, &createInfo, nullptr, &cache_) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline cache");
+        }
+        std::cout << "PipelineCache created with " << data.size() << " bytes initial data" << std::endl;
+    }
+
+    PipelineCache::~PipelineCache() {
+        Save();
+        vkDestroyPipelineCache(device_, cache_, nullptr);
+    }
+
+    void PipelineCache::Save() {
+        size_t size = 0;
+        if (vkGetPipelineCacheData(device_, cache_, &size, nullptr) != VK_SUCCESS || size == 0) {
+            return;
+        }
+        std::string data(size, '\0');
+        if (vkGetPipelineCacheData(device_, cache_, &size, data.data()) != VK_SUCCESS) {
+            std::cerr << "PipelineCache failed to get cache data" << std::endl;
+            return;
+        }
+        data.resize(size);
+
+        // 写入临时文件后 rename 覆盖，rename 在同一文件系统内是原子的
+        auto tmpPath = path_ + ".tmp";
+        {
+            std::ofstream output(tmpPath, std::ios::binary | std::ios::trunc);
+            output.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!output) {
+                std::cerr << "PipelineCache failed to write " << tmpPath << std::endl;
+                return;
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, path_, ec);
+        if (ec) {
+            std::cerr << "PipelineCache failed to replace " << path_ << ": " << ec.message() << std::endl;
+            std::filesystem::remove(tmpPath, ec);
+            return;
+        }
+        std::cout << "PipelineCache saved " << size << " bytes to " << path_ << std::endl;
+    }
+
+    /**
+     * VkPipelineCacheHeaderVersionOne:
+     * headerSize | headerVersion | vendorID | deviceID | pipelineCacheUUID[VK_UUID_SIZE]
+     * 部分驱动遇到其他设备的缓存数据会出错，创建前自己校验一次
+     */
+    bool PipelineCache::validateHeader(const std::string &data) const {
+        constexpr size_t kHeaderSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+        if (data.size() < kHeaderSize) {
+            return false;
+        }
+        uint32_t header[4];
+        memcpy(header, data.data(), sizeof(header));
+        if (header[0] < kHeaderSize || header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+            return false;
+        }
+        if (header[2] != properties_.vendorID || header[3] != properties_.deviceID) {
+            return false;
+        }
+        return memcmp(data.data() + sizeof(header), properties_.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+}
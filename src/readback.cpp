@@ -0,0 +1,170 @@
+#include "../include/readback.h"
+#include "../include/context.h"
+#include "../stb_image/stb_image_write.h"
+
+namespace render_2d {
+    void CapturedImage::ConvertToRGBA() {
+        if (format != VK_FORMAT_B8G8R8A8_UNORM && format != VK_FORMAT_B8G8R8A8_SRGB) {
+            return;
+        }
+        for (size_t i = 0; i + 3 < pixels.size(); i += 4) {
+            std::swap(pixels[i], pixels[i + 2]);
+        }
+        format = format == VK_FORMAT_B8G8R8A8_SRGB ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+
+    ReadbackRing::ReadbackRing(uint32_t frameCount, VkDevice device) : device_(device) {
+        slots_.resize(frameCount);
+    }
+
+    ReadbackRing::~ReadbackRing() {
+        slots_.clear();
+    }
+
+    void ReadbackRing::Record(VkCommandBuffer cmd, uint32_t frame, VkImage image, VkImageLayout layout,
+                              VkExtent2D extent, VkFormat format) {
+        auto &slot = slots_[frame];
+        uint64_t size = static_cast<uint64_t>(extent.width) * extent.height * 4;
+        // 该帧上一次提交已经完成，旧的回读 buffer 不再被GPU使用，尺寸不够时直接重建
+        if (!slot.buffer || slot.buffer->buffer_size_ < size) {
+            slot.buffer = std::make_unique<Buffer>(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                   MemoryPreference::Readback(), device_);
+        }
+        slot.callback = nullptr;
+        slot.extent = extent;
+        slot.format = format;
+
+        VkImageMemoryBarrier imageBarrier{};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = image;
+        imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+        // 交换链图像处于 PRESENT_SRC，先转换为 TRANSFER_SRC (离屏图像由 render pass 转换好)
+        // render pass 的外部依赖 (COLOR_ATTACHMENT_OUTPUT -> TRANSFER) 覆盖颜色写入和 finalLayout 转换，
+        // srcStage 包含 TRANSFER 与它串联
+        bool transition = layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        if (transition) {
+            imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            imageBarrier.oldLayout = layout;
+            imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+        }
+
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {extent.width, extent.height, 1};
+        vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer->buffer_, 1, &region);
+
+        if (transition) {
+            // 拷贝只读图像，恢复布局只需要执行依赖，present 由信号量保证顺序
+            imageBarrier.srcAccessMask = 0;
+            imageBarrier.dstAccessMask = 0;
+            imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            imageBarrier.newLayout = layout;
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+        }
+
+        // 拷贝写入对 host 可见
+        VkBufferMemoryBarrier bufferBarrier{};
+        bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.buffer = slot.buffer->buffer_;
+        bufferBarrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                             0, nullptr, 1, &bufferBarrier, 0, nullptr);
+    }
+
+    void ReadbackRing::Arm(uint32_t frame, Callback callback) {
+        slots_[frame].callback = std::move(callback);
+    }
+
+    void ReadbackRing::Collect(uint32_t frame) {
+        auto &slot = slots_[frame];
+        if (!slot.callback) {
+            return;
+        }
+        auto callback = std::move(slot.callback);
+        slot.callback = nullptr;
+
+        CapturedImage image;
+        image.width = slot.extent.width;
+        image.height = slot.extent.height;
+        image.format = slot.format;
+        image.pixels.resize(static_cast<size_t>(image.width) * image.height * 4);
+        // HOST_CACHED 内存可能不是 coherent，读取前 invalidate
+        slot.buffer->Invalidate();
+        memcpy(image.pixels.data(), slot.buffer->map, image.pixels.size());
+        callback(std::move(image));
+    }
+
+    void ReadbackRing::CollectAll() {
+        for (uint32_t frame = 0; frame < slots_.size(); frame++) {
+            Collect(frame);
+        }
+    }
+
+    ImageWriter::ImageWriter() : thread_(&ImageWriter::run, this) {}
+
+    ImageWriter::~ImageWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_one();
+        thread_.join();
+    }
+
+    void ImageWriter::Write(const std::string &path, CapturedImage &&image) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(Job{path, std::move(image)});
+        }
+        cond_.notify_one();
+    }
+
+    void ImageWriter::run() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+                if (jobs_.empty()) {
+                    return; // stop_ 且队列已经写完
+                }
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            writeFile(job);
+        }
+    }
+
+    void ImageWriter::writeFile(Job &job) {
+        auto &path = job.path;
+        auto &image = job.image;
+        image.ConvertToRGBA();
+        bool png = path.size() >= 4 && path.compare(path.size() - 4, 4, ".png") == 0;
+        if (png) {
+            auto stride = static_cast<int>(image.width * 4);
+            if (!stbi_write_png(path.c_str(), static_cast<int>(image.width), static_cast<int>(image.height), 4,
+                                image.pixels.data(), stride)) {
+                std::cerr << "ImageWriter failed to write " << path << std::endl;
+            }
+            return;
+        }
+        std::ofstream output(path, std::ios::binary | std::ios::trunc);
+        output.write(reinterpret_cast<const char *>(image.pixels.data()),
+                     static_cast<std::streamsize>(image.pixels.size()));
+        if (!output) {
+            std::cerr << "ImageWriter failed to write " << path << std::endl;
+        }
+    }
+}
@@ -15,6 +15,7 @@ namespace render_2d {
         ctx.InitRenderProcess();
         ctx.swapchain_->CreateFramebuffers(width, height);
         ctx.InitCommandManager();
+        ctx.InitUploadManager();
 
         // init vulkan Renderer
         renderer_ = std::make_unique<Renderer>(Context::GetInstance().swapchain_->images.size());
@@ -22,11 +23,30 @@ namespace render_2d {
         renderer_->SetProjectMat(width, 0, 0, height, -1, 1);
     }
 
+    void SetPreferredDevice(const std::string &device) {
+        Context::SetDeviceOverride(device);
+    }
+
+    void InitHeadless(const std::vector<const char *> &extensions, int width, int height, int frameCount) {
+        Context::Init(extensions, nullptr);
+        auto &ctx = Context::GetInstance();
+        ctx.InitShaderModules();
+        ctx.InitOffscreenSwapChain(width, height, frameCount);
+        ctx.InitRenderProcess();
+        ctx.swapchain_->CreateFramebuffers(width, height);
+        ctx.InitCommandManager();
+        ctx.InitUploadManager();
+
+        renderer_ = std::make_unique<Renderer>(frameCount);
+        renderer_->SetProjectMat(width, 0, 0, height, -1, 1);
+    }
+
     void Quit() {
         // 等待GPU所有操作完成后释放资源
         auto &ctx = Context::GetInstance();
         vkDeviceWaitIdle(ctx.device_);
         renderer_.reset();
+        ctx.QuitUploadManager();
         ctx.render_process_.reset();
         ctx.QuitSwapChain();
         ctx.QuitCommandManager();
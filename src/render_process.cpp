@@ -2,26 +2,31 @@
 // Created by 12381 on 24-7-25.
 //
 
+#include <algorithm>
 #include "../include/render_process.h"
+#include "../include/context.h"
 
 namespace render_2d {
     RenderProcess::RenderProcess(VkDevice &device, SwapChain &swapchain, Shader &shader) : device_(device),
                                                                                            swapchain_(swapchain) {
         initLayout(shader);
         initRenderPass();
-        createPipeline(shader);
+        pipeline_ = createPipeline(shader.GetShaderStages(), shader.GetVertexInputs());
+        immediatePipeline_ = createPipeline(shader.GetImmediateShaderStages(), shader.GetImmediateVertexInputs());
         std::cout << "Initializing Render Process...\n";
     }
 
     RenderProcess::~RenderProcess() {
         vkDestroyRenderPass(device_, renderPass_, nullptr);
-        vkDestroyPipelineLayout(device_, layout_, nullptr);
         vkDestroyPipeline(device_, pipeline_, nullptr);
+        vkDestroyPipeline(device_, immediatePipeline_, nullptr);
         pipeline_ = VK_NULL_HANDLE;
+        immediatePipeline_ = VK_NULL_HANDLE;
         std::cout << "Graphics pipeline destroyed successfully." << std::endl;
     }
 
-    void RenderProcess::createPipeline(Shader &shader) {
+    VkPipeline RenderProcess::createPipeline(const std::vector<VkPipelineShaderStageCreateInfo> &stages,
+                                             const std::vector<VertexInput> &inputs) {
 
         // 图像相关pipeline需要加上 graphics
         VkGraphicsPipelineCreateInfo pipelineCreateInfo{};
@@ -29,12 +34,42 @@ namespace render_2d {
         // 1. Vertex input
         VkPipelineVertexInputStateCreateInfo inputState{};
         inputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        auto attribute = Vec::GetAttributeDescription();
-        auto binding = Vec::GetBindingDescription();
-        inputState.vertexAttributeDescriptionCount = 1;
-        inputState.vertexBindingDescriptionCount = 1;
-        inputState.pVertexAttributeDescriptions = &attribute;
-        inputState.pVertexBindingDescriptions = &binding;
+        // 属性的 binding / 偏移 / 格式由 Vec 描述 CPU 端数据布局，shader 读取哪些 location 由反射决定
+        // (立即绘制只读取单位矩形顶点，没有实例流)
+        std::vector<VkVertexInputAttributeDescription> attributes;
+        std::vector<VkVertexInputBindingDescription> bindings;
+        auto allAttributes = Vec::GetAttributeDescriptions();
+        auto allBindings = Vec::GetBindingDescriptions();
+        for (auto &input: inputs) {
+            auto attribute = std::find_if(allAttributes.begin(), allAttributes.end(),
+                                          [&input](const VkVertexInputAttributeDescription &description) {
+                                              return description.location == input.location;
+                                          });
+            if (attribute == allAttributes.end()) {
+                throw std::runtime_error("Vertex shader input location " + std::to_string(input.location) +
+                                         " has no vertex attribute");
+            }
+            if (attribute->format != input.format) {
+                throw std::runtime_error("Vertex shader input location " + std::to_string(input.location) +
+                                         " does not match the vertex attribute format");
+            }
+            attributes.push_back(*attribute);
+            auto used = std::any_of(bindings.begin(), bindings.end(),
+                                    [&attribute](const VkVertexInputBindingDescription &binding) {
+                                        return binding.binding == attribute->binding;
+                                    });
+            if (!used) {
+                for (auto &binding: allBindings) {
+                    if (binding.binding == attribute->binding) {
+                        bindings.push_back(binding);
+                    }
+                }
+            }
+        }
+        inputState.vertexAttributeDescriptionCount = attributes.size();
+        inputState.vertexBindingDescriptionCount = bindings.size();
+        inputState.pVertexAttributeDescriptions = attributes.data();
+        inputState.pVertexBindingDescriptions = bindings.data();
         pipelineCreateInfo.pVertexInputState = &inputState;
 
         // 2. Vertex Assembling 指定每个顶点连成的图元
@@ -45,29 +80,24 @@ namespace render_2d {
         pipelineCreateInfo.pInputAssemblyState = &assemblyStateCreateInfo;
 
         // 3. Vertex Shaders && Fragment Shaders
-        auto stage = shader.GetShaderStages(); // get vertex and fragment shader VkPipelineShaderStageCreateInfo
-        pipelineCreateInfo.stageCount = stage.size();
-        pipelineCreateInfo.pStages = stage.data();
+        pipelineCreateInfo.stageCount = stages.size();
+        pipelineCreateInfo.pStages = stages.data();
 
-        // 4.viewport
+        // 4.viewport : 视口和裁切为动态状态，录制时通过 vkCmdSetViewport / vkCmdSetScissor 设置
+        // 交换链尺寸变化时不需要重建 pipeline
         VkPipelineViewportStateCreateInfo viewportState{};
         viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        VkViewport viewport;
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = static_cast<float>(swapchain_.info.imageExtent.width);
-        viewport.height = static_cast<float>(swapchain_.info.imageExtent.height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
         viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport; // 视口转换
         viewportState.scissorCount = 1;
-        VkRect2D viewportScissor{};
-        viewportScissor.offset = {0, 0};
-        viewportScissor.extent = swapchain_.info.imageExtent;
-        viewportState.pScissors = &viewportScissor; // 裁切设置
         pipelineCreateInfo.pViewportState = &viewportState;
 
+        std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = dynamicStates.size();
+        dynamicState.pDynamicStates = dynamicStates.data();
+        pipelineCreateInfo.pDynamicState = &dynamicState;
+
         // 5.光栅化
         VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo{};
         rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -93,7 +123,14 @@ namespace render_2d {
         colorBlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
         colorBlendState.attachmentCount = 1; // 1个颜色附件
         VkPipelineColorBlendAttachmentState attachmentState{};
-        attachmentState.blendEnable = VK_FALSE; // 禁用color混合
+        // 纹理带 alpha，开启 alpha 混合 : color = src * srcAlpha + dst * (1 - srcAlpha)
+        attachmentState.blendEnable = VK_TRUE;
+        attachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        attachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        attachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+        attachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        attachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        attachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
         // 如何往纹理附件输入颜色
         attachmentState.colorWriteMask =
                 VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
@@ -108,23 +145,29 @@ namespace render_2d {
         // 10. renderPass
         pipelineCreateInfo.renderPass = renderPass_;
 
-        auto res = vkCreateGraphicsPipelines(device_, nullptr, 1,
-                                             &pipelineCreateInfo, nullptr, &pipeline_);
+        VkPipeline pipeline;
+        auto res = vkCreateGraphicsPipelines(device_, Context::GetInstance().pipelineCache_->GetCache(), 1,
+                                             &pipelineCreateInfo, nullptr, &pipeline);
         // create pipeline
         if (res != VK_SUCCESS) {
             throw std::runtime_error("Failed to create Render pipeline");
         }
         std::cout << "Graphics pipeline created successfully." << std::endl;
+        return pipeline;
     }
 
-    // 初始化 Layout，和uniform数据在shader中布局
+    // Layout 由 shader 反射生成，检查立即绘制的 push constant 块与 RectPushConstants 一致
     void RenderProcess::initLayout(Shader &shader) {
-        VkPipelineLayoutCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        auto setLayouts = shader.GetDescriptorSetLayouts();
-        createInfo.setLayoutCount = setLayouts.size();
-        createInfo.pSetLayouts = setLayouts.data();
-        vkCreatePipelineLayout(device_, &createInfo, nullptr, &layout_);
+        layout_ = shader.GetPipelineLayout();
+        auto &pushConstants = shader.GetReflection().pushConstants;
+        auto vertexRange = std::find_if(pushConstants.begin(), pushConstants.end(),
+                                        [](const VkPushConstantRange &range) {
+                                            return range.stageFlags & VK_SHADER_STAGE_VERTEX_BIT;
+                                        });
+        if (vertexRange == pushConstants.end() || vertexRange->offset != 0 ||
+            vertexRange->size != sizeof(RectPushConstants)) {
+            throw std::runtime_error("Immediate shader push constants do not match RectPushConstants");
+        }
         std::cout << "Pipeline layout created Success" << std::endl;
     }
 
@@ -143,7 +186,9 @@ namespace render_2d {
         VkAttachmentDescription attachmentDescription;
         attachmentDescription.format = swapchain_.info.format.format;
         attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // 离屏模式渲染完成后拷贝回CPU，交换链图像用于显示
+        attachmentDescription.finalLayout = swapchain_.IsOffscreen() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                                                     : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
         // 加载的时候全部清空
         attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
         // 存储到显存
@@ -185,8 +230,19 @@ namespace render_2d {
         renderPassInfo.pAttachments = &attachmentDescription;
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpassDescription;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
+        // 回读 (离屏的 ReadPixels / 交换链的 CaptureFrame)：颜色写入和 finalLayout 转换完成后才能执行拷贝
+        // 隐式的外部依赖 dstStage 为 BOTTOM_OF_PIPE，无法与之后的 transfer 串联，因此总是显式声明
+        VkSubpassDependency readbackDependency{};
+        readbackDependency.srcSubpass = 0;
+        readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+        readbackDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        readbackDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        readbackDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        std::array<VkSubpassDependency, 2> dependencies = {dependency, readbackDependency};
+
+        renderPassInfo.dependencyCount = dependencies.size();
+        renderPassInfo.pDependencies = dependencies.data();
 
         if (vkCreateRenderPass(device_, &renderPassInfo, nullptr, &renderPass_) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create Vulkan render pass.");
@@ -1,5 +1,9 @@
+#include <algorithm>
 #include <limits>
+#include <cmath>
+#include <numeric>
 #include "../include/renderer.h"
+#include "../include/cpu_profiler.h"
 
 namespace render_2d {
     const std::array<glm::vec2, 4> vertices = {
@@ -13,14 +17,32 @@ namespace render_2d {
 
     const Color initColor{0.0f, 1.0f, 0.0f, 1.0f};
 
+    // 实例流 buffer 的初始容量 (矩形个数)
+    constexpr size_t kInitialStreamInstances = 1024;
+
+    // 多线程录制时每段至少的绘制量 (实例数)，太少时线程调度的开销比录制本身大
+    constexpr size_t kMinRecordSliceDraws = 1024;
+
+    // 每一帧 uniform 环形分配器的区域大小
+    constexpr uint64_t kUniformRingFrameSize = 64 * 1024;
+
     Renderer::Renderer(int maxFlightCount) : maxFlightCount_(maxFlightCount), curFrame_(0) {
-        createFences();
+        auto &ctx = Context::GetInstance();
+        auto &extent = ctx.swapchain_->info.imageExtent;
+        width_ = static_cast<int>(extent.width);
+        height_ = static_cast<int>(extent.height);
+        frameValues_.assign(maxFlightCount_, 0);
         createSemaphores();
         createCmdBuffers();
         createVertexIndexBuffer();
         // vertex & indices buffer -> GPU device memory
         bufferVertexData();
+        createInstanceStreams();
         createUniformBuffers();
+        createWhiteTexture();
+        readback_ = std::make_unique<ReadbackRing>(maxFlightCount_, ctx.device_);
+        gpuProfiler_ = std::make_unique<GpuProfiler>(maxFlightCount_, ctx.queueFamilyIndices_.graphicsQueue.value(),
+                                                     ctx.physicalDevice_, ctx.device_);
 
         createDescriptorPool();
         allocateDescriptorSets();
@@ -34,119 +56,188 @@ namespace render_2d {
         std::cout << "Destroy Vulkan Renderer" << std::endl;
         auto &device = Context::GetInstance().device_;
 
-        vkDestroyDescriptorPool(device, colorDescriptorPool_, nullptr);
         vkDestroyDescriptorPool(device, mvpDescriptorPool_, nullptr);
+        recordWorkers_.reset();
 
-        hostVertexBuffer_.reset();
-        deviceVertexBuffer_.reset();
-        hostIndicesBuffer_.reset();
-        deviceIndicesBuffer_.reset();
+        // 析构前GPU已经空闲，交付还没有回调的截图，再等待图片写完
+        readback_->CollectAll();
+        readback_.reset();
+        imageWriter_.reset();
+        gpuProfiler_.reset();
 
-        for (auto &buffer: hostMVPUniformBufs_) {
-            buffer.reset();
-        }
-        for (auto &buffer: localMVPUniformBufs_) {
-            buffer.reset();
-        }
-        for (auto &buffer: hostColorUniformBufs) {
-            buffer.reset();
-        }
-        for (auto &buffer: localColorUniformBufs_) {
+        for (auto &buffer: instanceStreamBufs_) {
             buffer.reset();
         }
+        deviceVertexBuffer_.reset();
+        deviceIndicesBuffer_.reset();
+
+        uniformRing_.reset();
+        whiteTexture_.reset();
         for (auto &imageSem: imageAvaliableSems_) {
             vkDestroySemaphore(device, imageSem, nullptr);
         }
         for (auto &finishSem: renderFinishSems_) {
             vkDestroySemaphore(device, finishSem, nullptr);
         }
-        for (auto &fence: fences_) {
-            vkDestroyFence(device, fence, nullptr);
-        }
-    }
-
-    // 同步 CPU和 GPU
-    void Renderer::createFences() {
-        auto &device = Context::GetInstance().device_;
-        fences_.resize(maxFlightCount_);
-
-        for (auto &fence: fences_) {
-            VkFenceCreateInfo fenceInfo{};
-            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-            // VK_FENCE_CREATE_SIGNALED_BIT : 初始状态为已签发
-            fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-            vkCreateFence(device, &fenceInfo, nullptr, &fence);
-        }
-
-        std::cout << "Renderer createFences success" << std::endl;
     }
 
+    /**
+     * CPU 与 GPU 的同步使用 Context 的队列时间线 (frameValues_)，这里只创建 acquire / present 用的 binary semaphore
+     * imageAvaliableSems_ 按帧索引：该帧的时间线值完成后，上一次对它的等待一定已经结束
+     * renderFinishSems_ 按交换链图像索引：present 的等待没有 fence 可查，只有同一图像再次被获取时才能确定它已被消耗，
+     * 交换链重建时整组换新，旧的一组随旧交换链延迟销毁
+     */
     void Renderer::createSemaphores() {
         auto &device = Context::GetInstance().device_;
 
         imageAvaliableSems_.resize(maxFlightCount_);
-        renderFinishSems_.resize(maxFlightCount_);
-        VkResult res;
         for (size_t i = 0; i < maxFlightCount_; ++i) {
             VkSemaphoreCreateInfo availableSemsInfo{};
             availableSemsInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
             vkCreateSemaphore(device, &availableSemsInfo, nullptr, &imageAvaliableSems_[i]);
+        }
+        createRenderFinishSemaphores();
+        std::cerr << "Render createSemaphores success" << std::endl;
+    }
 
+    void Renderer::createRenderFinishSemaphores() {
+        auto &ctx = Context::GetInstance();
+        auto imageCount = ctx.swapchain_->images.size();
+        renderFinishSems_.clear();
+        while (renderFinishSems_.size() < imageCount) {
             VkSemaphoreCreateInfo renderFinishSemsInfo{};
             renderFinishSemsInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-            vkCreateSemaphore(device, &renderFinishSemsInfo, nullptr, &renderFinishSems_[i]);
-
+            VkSemaphore semaphore;
+            vkCreateSemaphore(ctx.device_, &renderFinishSemsInfo, nullptr, &semaphore);
+            renderFinishSems_.push_back(semaphore);
         }
-        std::cerr << "Render createSemaphores success" << std::endl;
     }
 
     void Renderer::createCmdBuffers() {
-        auto &cmd = Context::GetInstance().commandManager_;
-        cmdBufs_.resize(maxFlightCount_);
-        for (auto &buf: cmdBufs_) {
-            buf = cmd->allocateOneCmdBuffer();
-        }
+        // 每帧一个 transient pool，BeginFrame 等到该帧的时间线值后整体重置
+        Context::GetInstance().commandManager_->InitFramePools(maxFlightCount_);
         std::cerr << "Render createCmdBuffers success size ->" << maxFlightCount_ << std::endl;
     }
 
-    void Renderer::DrawRect(const Rect &rect) {
+    void Renderer::BeginFrame() {
+        // 等待该帧上一次提交在时间线上的值，之后该帧的 cmdBuffer、实例流 buffer 和 uniform 区域可以安全复用
+        RENDER2D_PROFILE_SCOPE("BeginFrame");
         auto &ctx = Context::GetInstance();
-        auto &device = ctx.device_;
-        auto &renderProcess = ctx.render_process_;
+        {
+            RENDER2D_PROFILE_SCOPE("wait frame");
+            ctx.timeline_->Wait(frameValues_[curFrame_]);
+        }
+        ctx.deletionQueue_->Collect();
+        uniformRing_->BeginFrame(curFrame_);
+        gpuProfiler_->BeginFrame(curFrame_);
+        ctx.commandManager_->ResetFrame(curFrame_);
+        readback_->Collect(curFrame_);
+
+        batchInstances_.clear();
+        drawRanges_.clear();
+        immediateDraws_.clear();
+        drawCalls_ = 0;
+        frameStarted_ = true;
+    }
+
+    void Renderer::DrawRect(const Rect &rect) {
+        // 纯色矩形采样白色纹理，与纹理矩形共用同一个 pipeline
+        pushInstance(RectInstance{rect.position, rect.size, drawColor_, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)},
+                     whiteTexture_->GetDescriptorSet());
+    }
+
+    void Renderer::DrawTexturedRect(const Rect &rect, const Texture &texture, const glm::vec4 &uvRect,
+                                    const Color &tint) {
+        pushInstance(RectInstance{rect.position, rect.size, tint, uvRect}, texture.GetDescriptorSet());
+    }
 
-        // 1. 等待上一帧的 fence 状态
-        if (vkWaitForFences(device, 1, &fences_[curFrame_], VK_TRUE, std::numeric_limits<uint64_t>::max()) !=
-            VK_SUCCESS) {
-            throw std::runtime_error("wait for fence failed");
+    void Renderer::DrawTexturedRect(const Rect &rect, const AtlasRegion &region, const Color &tint) {
+        DrawTexturedRect(rect, *region.texture, region.uvRect, tint);
+    }
+
+    void Renderer::DrawText(Font &font, const std::string &text, const glm::vec2 &position, float size,
+                            const Color &color) {
+        auto &layout = font.Layout(text);
+        // 排版以 rasterHeight 为单位，缩放到目标字号；基线在顶部向下 ascent 处
+        float scale = size / font.GetRasterHeight();
+        glm::vec2 origin = position + glm::vec2(0.0f, font.GetAscent() * scale);
+        for (auto &quad: layout.quads) {
+            glm::vec2 quadSize = quad.size * scale;
+            glm::vec2 center = origin + quad.offset * scale + quadSize * 0.5f;
+            pushInstance(RectInstance{center, quadSize, color, quad.uvRect}, quad.texture->GetDescriptorSet());
         }
-        vkResetFences(device, 1, &fences_[curFrame_]);
+    }
 
-        auto &cmd = cmdBufs_[curFrame_];
+    void Renderer::pushInstance(const RectInstance &instance, VkDescriptorSet texture) {
+        assert(frameStarted_);
+        // 裁切区域或纹理变化时开始新的一段，相同状态的连续矩形仍然合并为一次 draw
+        if (drawRanges_.empty() || drawRanges_.back().immediate || drawRanges_.back().clip != clipRect_ ||
+            drawRanges_.back().texture != texture) {
+            drawRanges_.push_back(DrawRange{clipRect_, texture, static_cast<uint32_t>(batchInstances_.size()), 0});
+        }
+        drawRanges_.back().instanceCount++;
+        // 每个矩形只写一个实例，单位矩形的 translate * scale 在 vertex shader 中完成
+        batchInstances_.push_back(instance);
+    }
 
-        // 2. MVP 矩阵变换
-        // trans_mat
-        glm::mat4 translateMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(rect.position, 0.0f));
-        // scale_mat
-        glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(rect.size, 1.0f));
-        auto modelMat = translateMatrix * scaleMatrix;
-        bufferMVPUniformData(modelMat);
+    void Renderer::DrawRectImmediate(const Rect &rect, const Color &color) {
+        auto model = glm::translate(glm::identity<glm::mat4>(), glm::vec3(rect.position, 0.0f));
+        model = glm::scale(model, glm::vec3(rect.size, 1.0f));
+        DrawRectImmediate(model, color);
+    }
 
-        // 3.查询交换链中下一个空 image
-        uint32_t imageIndex;
-        auto res = vkAcquireNextImageKHR(device, ctx.swapchain_->swapchain,
-                                         std::numeric_limits<uint64_t>::max(), imageAvaliableSems_[curFrame_],
-                                         VK_NULL_HANDLE,
-                                         &imageIndex);
+    void Renderer::DrawRectImmediate(const glm::mat4 &model, const Color &color, const Texture *texture,
+                                     const glm::vec4 &uvRect) {
+        assert(frameStarted_);
+        auto descriptorSet = texture ? texture->GetDescriptorSet() : whiteTexture_->GetDescriptorSet();
+        // 立即绘制单独成段，前后的实例不会跨过它合并，保证绘制顺序
+        drawRanges_.push_back(DrawRange{clipRect_, descriptorSet, 0, 0,
+                                        static_cast<uint32_t>(immediateDraws_.size())});
+        immediateDraws_.push_back(RectPushConstants{model, color, uvRect});
+    }
 
-        if (res != VK_SUCCESS) {
-            std::cerr << "Render Failed to acquire swap chain image" << std::endl;
+    void Renderer::SetClipRect(const Rect &clip) {
+        auto min = clip.position - clip.size * 0.5f;
+        auto max = clip.position + clip.size * 0.5f;
+        clipRect_ = glm::vec4(min, max);
+    }
+
+    void Renderer::ResetClipRect() {
+        clipRect_.reset();
+    }
+
+    void Renderer::EndFrame() {
+        if (!frameStarted_) {
             return;
         }
+        frameStarted_ = false;
+        RENDER2D_PROFILE_SCOPE("EndFrame");
 
-        // 4. 重置 CommandBuffer
-        vkResetCommandBuffer(cmd, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
+        auto &ctx = Context::GetInstance();
+        auto &renderProcess = ctx.render_process_;
+
+        // 1. 将本帧累积的实例写入该帧的实例流 buffer (host可见，无需拷贝到 device)
+        reserveInstanceStream(batchInstances_.size());
+        if (!batchInstances_.empty()) {
+            RENDER2D_PROFILE_SCOPE("copy instances");
+            memcpy(instanceStreamBufs_[curFrame_]->map, batchInstances_.data(),
+                   batchInstances_.size() * sizeof(RectInstance));
+        }
 
-        // 5. 开始记录 CommandBuffer
+        // 2.查询交换链中下一个空 image
+        uint32_t imageIndex;
+        if (!acquireTarget(imageIndex)) {
+            return;
+        }
+        bool offscreen = ctx.swapchain_->IsOffscreen();
+
+        // 本帧之前登记的上传先提交，同一队列上的绘制一定在拷贝之后执行
+        ctx.uploadManager_->Flush(gpuProfiler_.get());
+
+        // 3. 从该帧的 pool 中取 CommandBuffer，pool 已在 BeginFrame 中整体重置
+        auto cmd = ctx.commandManager_->AllocatePrimary(curFrame_);
+
+        // 4. 开始记录 CommandBuffer
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         // USAGE_ONE_TIME_SUBMIT_BIT : commandBuffer只执行一次，后续不再使用
@@ -154,8 +245,9 @@ namespace render_2d {
         // USAGE_SIMULTANEOUS_USE_BIT : 可以重复使用 （用于多个线程中同时使用同一个命令缓冲区，commandBuffer不能改变)
         beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
         vkBeginCommandBuffer(cmd, &beginInfo);
+        int frameScope = gpuProfiler_->Begin(cmd, "frame");
 
-        // 6. 开始执行 RenderPass ，通过执行 vkCmdBeginRenderPass
+        // 5. 开始执行 RenderPass ，通过执行 vkCmdBeginRenderPass
         VkRenderPassBeginInfo renderPassBeginInfo{};
         renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassBeginInfo.renderPass = renderProcess->renderPass_;
@@ -176,34 +268,37 @@ namespace render_2d {
             VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS：
             通道的内容将被记录到一个或多个次级命令缓冲区中,可以创建多个次级命令缓冲区，每个都包含一组特定的渲染命令，然后在需要时从主命令缓冲区中调用它们
         */
-        vkCmdBeginRenderPass(cmd, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        /* 7.
-       绑定渲染管线
-       使用GPU传入的顶点参数进行渲染 (多个buffer需要进行偏移)
-       传入uniform变量 (描述符绑定多个 uniform )
-       */
-
-        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          renderProcess->pipeline_); // 绑定pipeline
-        VkDeviceSize vertexBufferOffset = 0;
-        vkCmdBindVertexBuffers(cmd, 0, 1, &deviceVertexBuffer_->buffer_, &vertexBufferOffset);
-        vkCmdBindIndexBuffer(cmd, deviceIndicesBuffer_->buffer_, 0, VK_INDEX_TYPE_UINT32);
-
-        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, renderProcess->layout_, 0,
-                                1, &mvpDescriptorSets_[curFrame_], 0, nullptr);
-
-        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, renderProcess->layout_, 1,
-                                1, &colorDescriptorSets_[curFrame_], 0, nullptr);
-
-
-        // 执行 Draw 命令
-        // vkCmdDraw(cmd, 3, 1, 0, 0);
-        vkCmdDrawIndexed(cmd, 6, 1, 0, 0, 0);
+        // 6. 绘制本帧所有矩形：默认直接录制在主 commandBuffer 中，开启多线程录制时由工作线程录制 secondary
+        // 矩形变换由实例数据完成，model 固定为单位矩阵
+        uint32_t mvpOffset = bufferMVPUniformData(glm::identity<glm::mat4>());
+        uint32_t sliceCount = recordWorkers_ ? splitRecordSlices() : 1;
+        bool parallel = sliceCount > 1;
+        int passScope = gpuProfiler_->Begin(cmd, "render pass");
+        vkCmdBeginRenderPass(cmd, &renderPassBeginInfo,
+                             parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+        if (parallel) {
+            drawCalls_ = recordParallel(cmd, renderPassBeginInfo.framebuffer, mvpOffset, sliceCount);
+        } else {
+            RENDER2D_PROFILE_SCOPE("record");
+            setViewport(cmd);
+            drawCalls_ = recordBatch(cmd, drawRanges_.data(), drawRanges_.data() + drawRanges_.size(), mvpOffset,
+                                     gpuProfiler_.get());
+        }
 
-        // 6. 结束记录 renderPass && CommandBuffer
+        // 7. 结束记录 renderPass && CommandBuffer
         vkCmdEndRenderPass(cmd);
-        res = vkEndCommandBuffer(cmd);
+        gpuProfiler_->End(cmd, passScope);
+        bool capture = static_cast<bool>(captureCallback_);
+        if (capture) {
+            int readbackScope = gpuProfiler_->Begin(cmd, "readback");
+            auto &swapchain = ctx.swapchain_;
+            auto layout = offscreen ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+            readback_->Record(cmd, curFrame_, swapchain->images[imageIndex], layout, swapchain->info.imageExtent,
+                              swapchain->info.format.format);
+            gpuProfiler_->End(cmd, readbackScope);
+        }
+        gpuProfiler_->End(cmd, frameScope);
+        auto res = vkEndCommandBuffer(cmd);
         if (res != VK_SUCCESS) {
             std::cerr << "Render Failed to end command buffer" << std::endl;
         }
@@ -213,198 +308,514 @@ namespace render_2d {
         submitGraphicsInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
         submitGraphicsInfo.commandBufferCount = 1;
         submitGraphicsInfo.pCommandBuffers = &cmd;
-        submitGraphicsInfo.signalSemaphoreCount = 1;
-        submitGraphicsInfo.pSignalSemaphores = &renderFinishSems_[curFrame_];
-        submitGraphicsInfo.waitSemaphoreCount = 1;
+        // 离屏模式没有 acquire / present，不需要信号量
+        submitGraphicsInfo.signalSemaphoreCount = offscreen ? 0 : 1;
+        submitGraphicsInfo.pSignalSemaphores = &renderFinishSems_[imageIndex];
+        submitGraphicsInfo.waitSemaphoreCount = offscreen ? 0 : 1;
         submitGraphicsInfo.pWaitSemaphores = &imageAvaliableSems_[curFrame_];
         VkPipelineStageFlags flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
         submitGraphicsInfo.pWaitDstStageMask = &flags;
 
-        res = vkQueueSubmit(ctx.graphicsQueue_, 1, &submitGraphicsInfo, fences_[curFrame_]);
+        // 提交同时 signal 时间线上的下一个值，BeginFrame 再次使用该帧时等待它
+        {
+            RENDER2D_PROFILE_SCOPE("submit");
+            res = ctx.timeline_->Submit(ctx.graphicsQueue_, submitGraphicsInfo, frameValues_[curFrame_]);
+        }
         if (res != VK_SUCCESS) {
+            // 截图请求保留到下一帧，回读 buffer 没有被写入，不能交付
             std::cerr << "Render Failed to submit graphics queue res: " << res << std::endl;
             return;
         }
+        if (capture) {
+            readback_->Arm(curFrame_, std::move(captureCallback_));
+            captureCallback_ = nullptr;
+        }
+        // 本帧绑定的 buffer 被整块重新上传时，传输队列只需要等待本帧
+        deviceVertexBuffer_->lastGraphicsUse_ = frameValues_[curFrame_];
+        deviceIndicesBuffer_->lastGraphicsUse_ = frameValues_[curFrame_];
+        instanceStreamBufs_[curFrame_]->lastGraphicsUse_ = frameValues_[curFrame_];
+        // 本帧录制期间析构的资源在本帧执行完后释放
+        ctx.deletionQueue_->Seal(frameValues_[curFrame_]);
+        lastFrame_ = curFrame_;
+        lastImageIndex_ = imageIndex;
+
+        if (offscreen) {
+            curFrame_ = (curFrame_ + 1) % maxFlightCount_;
+            return;
+        }
 
-        // 7. 交换数据并提交 GPU
+        // 8. 交换数据并提交 GPU
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.pImageIndices = &imageIndex;
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = &ctx.swapchain_->swapchain;
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = &renderFinishSems_[curFrame_];
+        presentInfo.pWaitSemaphores = &renderFinishSems_[imageIndex];
 
-        res = vkQueuePresentKHR(ctx.presentQueue_, &presentInfo);
-        if (res != VK_SUCCESS) {
+        {
+            RENDER2D_PROFILE_SCOPE("present");
+            res = vkQueuePresentKHR(ctx.presentQueue_, &presentInfo);
+        }
+        if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR) {
+            swapchainDirty_ = true;
+        } else if (res != VK_SUCCESS) {
             std::cerr << "Render Failed to present to screen" << std::endl;
-            return;
         }
 
         curFrame_ = (curFrame_ + 1) % maxFlightCount_;
     }
 
-    // 如何创建顶点buffer
-    void Renderer::createVertexIndexBuffer() {
-        auto &ctx = Context::GetInstance();
-        // 创建并填充 Vertex Buffer
-        // VK_BUFFER_USAGE_VERTEX_BUFFER_BIT : 用于创建 vertex buffer (其他store..uniform...indirect)
-        // 一定要设置  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT , 要求内存对宿主机(CPU)可见
-        hostVertexBuffer_ = std::make_unique<Buffer>(sizeof(vertices), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                                     ctx.device_, ctx.physicalDevice_);
+    void Renderer::CaptureFrame(ReadbackRing::Callback callback) {
+        auto &swapchain = Context::GetInstance().swapchain_;
+        if (!(swapchain->info.imageUsage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+            std::cerr << "Render CaptureFrame: swapchain images do not support TRANSFER_SRC" << std::endl;
+            return;
+        }
+        captureCallback_ = std::move(callback);
+    }
 
-        /*  如果 HOST 不加 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-            需要每次 buffer写完调用 vkFlushMappedMemoryRanges 将内存刷新
-            每次读取buffer 需要调用  vkInvalidateMappedMemoryRanges 重置*/
+    void Renderer::CaptureFrameToFile(const std::string &path) {
+        if (!imageWriter_) {
+            imageWriter_ = std::make_unique<ImageWriter>();
+        }
+        auto writer = imageWriter_.get();
+        CaptureFrame([writer, path](CapturedImage &&image) {
+            writer->Write(path, std::move(image));
+        });
+    }
 
-        deviceVertexBuffer_ = std::make_unique<Buffer>(sizeof(vertices),
-                                                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-                                                       VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                                       ctx.device_, ctx.physicalDevice_);
-        /* 创建 Indices Buffer */
-        hostIndicesBuffer_ = std::make_unique<Buffer>(sizeof(indices),
-                                                      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                                      ctx.device_, ctx.physicalDevice_);
+    // 确定本帧的渲染目标，返回 false 时跳过该帧
+    bool Renderer::acquireTarget(uint32_t &imageIndex) {
+        RENDER2D_PROFILE_SCOPE("acquire image");
+        // 窗口尺寸变化后先重建交换链，最小化时直接跳过该帧
+        if (swapchainDirty_ && !recreateSwapchain()) {
+            return false;
+        }
 
-        deviceIndicesBuffer_ = std::make_unique<Buffer>(sizeof(indices),
-                                                        VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
-                                                        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                                        ctx.device_, ctx.physicalDevice_);
+        auto &swapchain = Context::GetInstance().swapchain_;
+        if (swapchain->IsOffscreen()) {
+            // 离屏图像与帧一一对应，等待该帧的时间线值之后图像不会再被GPU使用
+            imageIndex = curFrame_ % swapchain->images.size();
+            return true;
+        }
 
-        // copy host buffer -> device buffer
-        std::cout << "Renderer create VertexBuffer And IndicesBuffer success" << std::endl;
+        auto res = acquireNextImage(imageIndex);
+        if (res == VK_ERROR_OUT_OF_DATE_KHR) {
+            // 获取失败时信号量不会被 signal，重建后可以直接重新获取
+            swapchainDirty_ = true;
+            if (!recreateSwapchain()) {
+                return false;
+            }
+            res = acquireNextImage(imageIndex);
+        }
+        if (res == VK_SUBOPTIMAL_KHR) {
+            // 图像已经获取，本帧照常绘制并 present，下一帧再重建
+            swapchainDirty_ = true;
+        } else if (res != VK_SUCCESS) {
+            std::cerr << "Render Failed to acquire swap chain image res: " << res << std::endl;
+            return false;
+        }
+        return true;
     }
 
-    // 如何将顶点传入到GPU
-    void Renderer::bufferVertexData() {
-        uint32_t dataSize = sizeof(vertices);
-        memcpy(hostVertexBuffer_->map, vertices.data(), sizeof(vertices));
-        // copy hostBuffer -> deviceBuffer
-        transformBuffer2Device(*hostVertexBuffer_, *deviceVertexBuffer_, dataSize, 0, 0);
+    /**
+     * 同步回读最近一次提交的帧 (离屏模式)
+     * 等待该帧完成后拷贝到 host可见的回读 buffer，返回 width * height * 4 字节的 RGBA8 数据
+     */
+    std::vector<uint8_t> Renderer::ReadPixels() {
+        auto &ctx = Context::GetInstance();
+        auto &swapchain = ctx.swapchain_;
+        if (!swapchain->IsOffscreen()) {
+            throw std::runtime_error("ReadPixels is only supported in headless mode");
+        }
+        if (!lastImageIndex_) {
+            return {};
+        }
+
+        auto extent = swapchain->info.imageExtent;
+        uint64_t size = static_cast<uint64_t>(extent.width) * extent.height * 4;
+        Buffer readback(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryPreference::Readback(), ctx.device_);
 
-        dataSize = sizeof(indices);
-        memcpy(hostIndicesBuffer_->map, indices, dataSize);
-        transformBuffer2Device(*hostIndicesBuffer_, *deviceIndicesBuffer_, dataSize, 0, 0);
+        ctx.timeline_->Wait(frameValues_[lastFrame_]);
+
+        auto cmd = ctx.commandManager_->allocateOneCmdBuffer();
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cmd, &beginInfo);
+
+        // render pass 结束时图像已经转换为 TRANSFER_SRC_OPTIMAL
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {extent.width, extent.height, 1};
+        vkCmdCopyImageToBuffer(cmd, swapchain->images[lastImageIndex_.value()], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               readback.buffer_, 1, &region);
+
+        // 拷贝写入对 host 可见
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = readback.buffer_;
+        barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                             0, nullptr, 1, &barrier, 0, nullptr);
+        vkEndCommandBuffer(cmd);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &cmd;
+        uint64_t copyValue;
+        auto res = ctx.timeline_->Submit(ctx.graphicsQueue_, submitInfo, copyValue);
+        if (res == VK_SUCCESS) {
+            ctx.timeline_->Wait(copyValue);
+        }
+        ctx.commandManager_->FreeCmdBuffer(cmd);
+        if (res != VK_SUCCESS) {
+            throw std::runtime_error("ReadPixels failed to submit copy");
+        }
+
+        readback.Invalidate();
+        std::vector<uint8_t> pixels(size);
+        memcpy(pixels.data(), readback.map, size);
+        return pixels;
     }
 
-    /**
-     * 使用 buffer 传递uniform对象,每一帧需要 host + deviceLocal buffer
-    */
-    void Renderer::createUniformBuffers() {
-        /* Init Vertex & Indices Buffer （固定图形不需要创建多个）*/
-        hostColorUniformBufs.resize(maxFlightCount_);
-        localColorUniformBufs_.resize(maxFlightCount_);
-        uint64_t uniformSize = sizeof(initColor);
+    VkResult Renderer::acquireNextImage(uint32_t &imageIndex) {
         auto &ctx = Context::GetInstance();
+        return vkAcquireNextImageKHR(ctx.device_, ctx.swapchain_->swapchain, std::numeric_limits<uint64_t>::max(),
+                                     imageAvaliableSems_[curFrame_], VK_NULL_HANDLE, &imageIndex);
+    }
 
-        for (auto &hostUniformBuffer: hostColorUniformBufs) {
-            hostUniformBuffer = std::make_unique<Buffer>(uniformSize,
-                                                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                                         ctx.device_, ctx.physicalDevice_);
+    /**
+     * 重建交换链：只等待各帧最近一次提交的时间线值 (不使用 vkDeviceWaitIdle，不等待之后的上传等无关提交)
+     * 之后旧 framebuffer 不再被GPU使用，RenderPass 和 Pipeline 继续复用
+     */
+    bool Renderer::recreateSwapchain() {
+        RENDER2D_PROFILE_SCOPE("recreate swapchain");
+        if (width_ == 0 || height_ == 0) {
+            return false;
         }
-        for (auto &deviceUniformBuf: localColorUniformBufs_) {
-            deviceUniformBuf = std::make_unique<Buffer>(uniformSize,
-                                                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
-                                                        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                                        ctx.device_, ctx.physicalDevice_);
+        auto &ctx = Context::GetInstance();
+        waitAllFrames();
+        // 旧交换链上排队的 present 可能还在等待 renderFinish 信号量，maxFlightCount 帧之后再销毁
+        if (!ctx.swapchain_->Recreate(width_, height_, maxFlightCount_)) {
+            return false;
+        }
+        if (!ctx.swapchain_->IsOffscreen()) {
+            auto device = ctx.device_;
+            ctx.deletionQueue_->PushAfterFrames(maxFlightCount_, [device, semaphores = renderFinishSems_]() {
+                for (auto semaphore: semaphores) {
+                    vkDestroySemaphore(device, semaphore, nullptr);
+                }
+            });
+            createRenderFinishSemaphores();
         }
+        swapchainDirty_ = false;
+        return true;
+    }
 
-        /* Init MVP uniform buffer (MVP 变换每一帧不同，需创建多个)*/
-        hostMVPUniformBufs_.resize(maxFlightCount_);
-        localMVPUniformBufs_.resize(maxFlightCount_);
-        auto mvpSize = sizeof(glm::mat4) * 3;
+    // 时间线值单调递增，等待最大的值即等待所有帧
+    void Renderer::waitAllFrames() {
+        Context::GetInstance().timeline_->Wait(*std::max_element(frameValues_.begin(), frameValues_.end()));
+    }
 
-        for (auto &hostMVPBuf: hostMVPUniformBufs_) {
-            hostMVPBuf = std::make_unique<Buffer>(mvpSize,
-                                                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                                  ctx.device_, ctx.physicalDevice_);
+    void Renderer::Resize(int width, int height) {
+        if (width == width_ && height == height_) {
+            return;
         }
+        width_ = width;
+        height_ = height;
+        swapchainDirty_ = true;
+    }
 
-        for (auto &deviceMVPBuf: localMVPUniformBufs_) {
-            deviceMVPBuf = std::make_unique<Buffer>(mvpSize,
-                                                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
-                                                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                                    ctx.device_, ctx.physicalDevice_);
+    // viewport 和 scissor 是 pipeline 的动态状态，每次录制时按当前交换链尺寸设置
+    void Renderer::setViewport(VkCommandBuffer cmd) {
+        auto &extent = Context::GetInstance().swapchain_->info.imageExtent;
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = {0, 0};
+        scissor.extent = extent;
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+    }
 
+    /* 绑定渲染管线、单位矩形顶点、实例流和 uniform，每段 (裁切区域 + 纹理) 一次 vkCmdDrawIndexed(6, count) */
+    uint32_t Renderer::recordBatch(VkCommandBuffer cmd, const DrawRange *first, const DrawRange *last,
+                                   uint32_t mvpOffset, GpuProfiler *profiler) {
+        auto &renderProcess = Context::GetInstance().render_process_;
+        if (first >= last) {
+            return 0;
         }
 
-        std::cout << "Renderer create Color And MVP Uniform success" << std::endl;
+        // binding 0 : 单位矩形顶点 (per vertex) / binding 1 : 矩形实例 (per instance)
+        std::array<VkBuffer, 2> vertexBuffers = {deviceVertexBuffer_->buffer_, instanceStreamBufs_[curFrame_]->buffer_};
+        std::array<VkDeviceSize, 2> vertexBufferOffsets = {0, 0};
+        vkCmdBindVertexBuffers(cmd, 0, vertexBuffers.size(), vertexBuffers.data(), vertexBufferOffsets.data());
+        vkCmdBindIndexBuffer(cmd, deviceIndicesBuffer_->buffer_, 0, VK_INDEX_TYPE_UINT32);
+
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, renderProcess->layout_, 0,
+                                1, &mvpDescriptorSet_, 1, &mvpOffset);
+
+        // 两个 pipeline 共用同一个 layout，切换 pipeline 不影响已绑定的描述符集
+        VkPipeline boundPipeline = VK_NULL_HANDLE;
+        VkDescriptorSet boundTexture = VK_NULL_HANDLE;
+        uint32_t drawCalls = 0;
+        for (auto it = first; it != last; ++it) {
+            auto &range = *it;
+            auto scissor = clipToScissor(range.clip);
+            if (scissor.extent.width == 0 || scissor.extent.height == 0) {
+                continue; // 完全被裁掉
+            }
+            auto pipeline = range.immediate ? renderProcess->immediatePipeline_ : renderProcess->pipeline_;
+            if (pipeline != boundPipeline) {
+                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                boundPipeline = pipeline;
+            }
+            if (range.texture != boundTexture) {
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, renderProcess->layout_, 1,
+                                        1, &range.texture, 0, nullptr);
+                boundTexture = range.texture;
+            }
+            vkCmdSetScissor(cmd, 0, 1, &scissor);
+            int scope = profiler ? profiler->Begin(cmd, range.immediate ? "immediate" : "batch") : -1;
+            if (range.immediate) {
+                vkCmdPushConstants(cmd, renderProcess->layout_, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                                   sizeof(RectPushConstants), &immediateDraws_[range.immediate.value()]);
+                vkCmdDrawIndexed(cmd, 6, 1, 0, 0, 0);
+            } else {
+                vkCmdDrawIndexed(cmd, 6, range.instanceCount, 0, 0, range.firstInstance);
+            }
+            drawCalls++;
+            if (profiler) {
+                profiler->End(cmd, scope);
+            }
+        }
+        return drawCalls;
     }
 
-    void Renderer::SetDrawColor(const Color &color) {
-        for (size_t i = 0; i < hostColorUniformBufs.size(); i++) {
-            auto &buffer = hostColorUniformBufs[i];
+    /**
+     * 按绘制量 (实例数，一次立即绘制计 1) 把 drawRanges_ 按顺序平均切到 recordSlices_ 中，
+     * 一个大的实例段会在实例边界上拆成多段，少量大批次的场景也能分到所有工作线程
+     */
+    uint32_t Renderer::splitRecordSlices() {
+        size_t total = 0;
+        for (auto &range: drawRanges_) {
+            total += range.immediate ? 1 : range.instanceCount;
+        }
+        auto sliceCount = static_cast<uint32_t>(std::min<size_t>(recordWorkers_->GetThreadCount(),
+                                                                 total / kMinRecordSliceDraws));
+        if (sliceCount <= 1) {
+            return 1;
+        }
+
+        recordSlices_.resize(sliceCount);
+        for (auto &slice: recordSlices_) {
+            slice.clear();
+        }
+        size_t perSlice = (total + sliceCount - 1) / sliceCount;
+        uint32_t slice = 0;
+        size_t filled = 0;
+        for (auto &range: drawRanges_) {
+            if (range.immediate) {
+                recordSlices_[slice].push_back(range);
+                filled++;
+            } else {
+                auto part = range;
+                uint32_t remaining = range.instanceCount;
+                while (remaining > 0) {
+                    // 最后一段收下剩余的所有实例
+                    size_t capacity = slice + 1 < sliceCount ? perSlice - filled : remaining;
+                    part.instanceCount = static_cast<uint32_t>(std::min<size_t>(remaining, capacity));
+                    recordSlices_[slice].push_back(part);
+                    part.firstInstance += part.instanceCount;
+                    remaining -= part.instanceCount;
+                    filled += part.instanceCount;
+                    if (filled >= perSlice && slice + 1 < sliceCount) {
+                        slice++;
+                        filled = 0;
+                    }
+                }
+                continue;
+            }
+            if (filled >= perSlice && slice + 1 < sliceCount) {
+                slice++;
+                filled = 0;
+            }
+        }
+        return sliceCount;
+    }
 
-            memcpy(buffer->map, &color, sizeof(color));
+    /**
+     * 每个工作线程用自己的 pool 把 recordSlices_ 中的一段录制到一个 secondary commandBuffer，
+     * 主 commandBuffer 按段的顺序 vkCmdExecuteCommands，绘制顺序与单线程录制一致
+     */
+    uint32_t Renderer::recordParallel(VkCommandBuffer cmd, VkFramebuffer framebuffer, uint32_t mvpOffset,
+                                      uint32_t sliceCount) {
+        RENDER2D_PROFILE_SCOPE("record");
+        auto &ctx = Context::GetInstance();
+        std::vector<VkCommandBuffer> secondaries(sliceCount);
+        std::vector<uint32_t> drawCalls(sliceCount);
+        recordWorkers_->ParallelFor(sliceCount, [&](uint32_t slice, uint32_t thread) {
+            RENDER2D_PROFILE_SCOPE("record slice");
+            auto &ranges = recordSlices_[slice];
+            auto secondary = ctx.commandManager_->AllocateSecondary(curFrame_, thread);
+
+            VkCommandBufferInheritanceInfo inheritance{};
+            inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            inheritance.renderPass = ctx.render_process_->renderPass_;
+            inheritance.subpass = 0;
+            inheritance.framebuffer = framebuffer;
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                              VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            beginInfo.pInheritanceInfo = &inheritance;
+            vkBeginCommandBuffer(secondary, &beginInfo);
+            // 动态状态不会从主 commandBuffer 继承
+            setViewport(secondary);
+            drawCalls[slice] = recordBatch(secondary, ranges.data(), ranges.data() + ranges.size(), mvpOffset);
+            vkEndCommandBuffer(secondary);
+            secondaries[slice] = secondary;
+        });
+        vkCmdExecuteCommands(cmd, secondaries.size(), secondaries.data());
+        return std::accumulate(drawCalls.begin(), drawCalls.end(), 0u);
+    }
 
-            // copy hostUniformBuffer -> deviceUniformBuffer
-            transformBuffer2Device(*buffer, *localColorUniformBufs_[i],
-                                   sizeof(color), 0, 0);
+    void Renderer::SetRecordThreadCount(uint32_t threadCount) {
+        auto &ctx = Context::GetInstance();
+        // 等待所有帧执行完，旧 pool 中的 secondary commandBuffer 不再被使用
+        waitAllFrames();
+        recordWorkers_.reset();
+        if (threadCount <= 1) {
+            return;
         }
+        ctx.commandManager_->InitThreadPools(maxFlightCount_, threadCount);
+        recordWorkers_ = std::make_unique<ThreadPool>(threadCount);
+        std::cout << "Renderer record threads -> " << threadCount << std::endl;
     }
 
+    // 裁切区域与 framebuffer 求交，scissor 的 offset 不能为负
+    VkRect2D Renderer::clipToScissor(const std::optional<glm::vec4> &clip) {
+        auto &extent = Context::GetInstance().swapchain_->info.imageExtent;
+        VkRect2D scissor{};
+        if (!clip) {
+            scissor.extent = extent;
+            return scissor;
+        }
+        auto x0 = std::clamp(std::floor(clip->x), 0.0f, static_cast<float>(extent.width));
+        auto y0 = std::clamp(std::floor(clip->y), 0.0f, static_cast<float>(extent.height));
+        auto x1 = std::clamp(std::ceil(clip->z), x0, static_cast<float>(extent.width));
+        auto y1 = std::clamp(std::ceil(clip->w), y0, static_cast<float>(extent.height));
+        scissor.offset = {static_cast<int32_t>(x0), static_cast<int32_t>(y0)};
+        scissor.extent = {static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0)};
+        return scissor;
+    }
 
-    void Renderer::transformBuffer2Device(Buffer &src, Buffer &dst, size_t size, size_t srcOffset, size_t dstOffset) {
+    // 如何创建顶点buffer
+    void Renderer::createVertexIndexBuffer() {
         auto &ctx = Context::GetInstance();
-        auto cmdBuf = ctx.commandManager_->allocateOneCmdBuffer();
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-        vkBeginCommandBuffer(cmdBuf, &beginInfo);
-
-        VkBufferCopy copy{};
-        copy.size = size;
-        copy.srcOffset = srcOffset;
-        copy.dstOffset = dstOffset;
-        vkCmdCopyBuffer(cmdBuf, src.buffer_, dst.buffer_, 1, &copy);
-        vkEndCommandBuffer(cmdBuf);
-
-        VkSubmitInfo submit{};
-        submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submit.commandBufferCount = 1;
-        submit.pCommandBuffers = &cmdBuf;
-        auto res = vkQueueSubmit(ctx.graphicsQueue_, 1, &submit, nullptr);
-        if (res != VK_SUCCESS) {
-            std::cerr << "Render Failed to transformBuffer2Device res: " << res << std::endl;
+        // 创建 Vertex Buffer，数据通过 UploadManager 的 staging buffer 拷贝进来
+        // VK_BUFFER_USAGE_VERTEX_BUFFER_BIT : 用于创建 vertex buffer (其他store..uniform...indirect)
+        deviceVertexBuffer_ = std::make_unique<Buffer>(sizeof(vertices),
+                                                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                                                       VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                       MemoryPreference::GpuOnly(), ctx.device_);
+        /* 创建 Indices Buffer */
+        deviceIndicesBuffer_ = std::make_unique<Buffer>(sizeof(indices),
+                                                        VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                                                        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                        MemoryPreference::GpuOnly(), ctx.device_);
+
+        std::cout << "Renderer create VertexBuffer And IndicesBuffer success" << std::endl;
+    }
+
+    // 如何将顶点传入到GPU : 只登记拷贝，第一帧提交前随 Flush 一起提交，不阻塞CPU
+    void Renderer::bufferVertexData() {
+        auto &uploader = Context::GetInstance().uploadManager_;
+        uploader->Upload(*deviceVertexBuffer_, vertices.data(), sizeof(vertices));
+        uploader->Upload(*deviceIndicesBuffer_, indices, sizeof(indices));
+    }
+
+    // 每一帧一个实例流 buffer，实例流每帧都会重写，直接使用 host可见内存，省去 staging 拷贝
+    void Renderer::createInstanceStreams() {
+        instanceStreamBufs_.resize(maxFlightCount_);
+        for (auto &buffer: instanceStreamBufs_) {
+            buffer = createInstanceStreamBuffer(kInitialStreamInstances * sizeof(RectInstance));
+        }
+    }
+
+    std::unique_ptr<Buffer> Renderer::createInstanceStreamBuffer(uint64_t size) {
+        auto &ctx = Context::GetInstance();
+        return std::make_unique<Buffer>(size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                        MemoryPreference::Streaming(), ctx.device_);
+    }
+
+    /**
+     * 保证当前帧的实例流 buffer 至少能容纳 instanceCount 个矩形，不够时按2倍扩容
+     * 只会在等待该帧的时间线值之后调用，旧 buffer 不会再被GPU使用，可以直接销毁
+     */
+    void Renderer::reserveInstanceStream(size_t instanceCount) {
+        auto &buffer = instanceStreamBufs_[curFrame_];
+        uint64_t size = instanceCount * sizeof(RectInstance);
+        if (buffer->buffer_size_ >= size) {
             return;
         }
-        vkDeviceWaitIdle(ctx.device_);
-        ctx.commandManager_->FreeCmdBuffer(cmdBuf);
+        uint64_t capacity = buffer->buffer_size_;
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        buffer = createInstanceStreamBuffer(capacity);
     }
 
+    /**
+     * 所有帧共享一个持久映射的 uniform 环形 buffer，每帧写入自己的区域
+     * 颜色随实例流传入，只需要 MVP uniform
+    */
+    void Renderer::createUniformBuffers() {
+        auto &ctx = Context::GetInstance();
+        uniformRing_ = std::make_unique<UniformRing>(kUniformRingFrameSize, maxFlightCount_,
+                                                     ctx.device_, ctx.physicalDevice_);
+        std::cout << "Renderer create MVP Uniform ring success" << std::endl;
+    }
+
+    // 1x1 白色纹理，纯色矩形乘以白色即为原色
+    void Renderer::createWhiteTexture() {
+        const uint32_t white = 0xFFFFFFFF;
+        whiteTexture_ = std::make_unique<Texture>(1, 1, &white, VK_FILTER_NEAREST);
+    }
+
+    // 之后 DrawRect 追加的矩形都使用该颜色
+    void Renderer::SetDrawColor(const Color &color) {
+        drawColor_ = color;
+    }
+
+
     void Renderer::createDescriptorPool() {
         auto &device = Context::GetInstance().device_;
         VkDescriptorPoolSize poolSizes{};
-        poolSizes.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes.descriptorCount = maxFlightCount_;
+        poolSizes.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        poolSizes.descriptorCount = 1;
 
-        /* 1. Init Color DescriptorPool */
+        /* Init MVP Vertex DescriptorPool */
         VkDescriptorPoolCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        createInfo.maxSets = maxFlightCount_;
+        createInfo.maxSets = 1;
         createInfo.poolSizeCount = 1;
         createInfo.pPoolSizes = &poolSizes;
-        auto res = vkCreateDescriptorPool(device, &createInfo, nullptr, &colorDescriptorPool_);
-
-        /* 2. Init MVP Vertex DescriptorPool */
-        VkDescriptorPoolCreateInfo createInfo2{};
-        createInfo2.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        createInfo2.maxSets = maxFlightCount_;
-        createInfo2.poolSizeCount = 1;
-        createInfo2.pPoolSizes = &poolSizes;
-        res = vkCreateDescriptorPool(device, &createInfo2, nullptr, &mvpDescriptorPool_);
+        auto res = vkCreateDescriptorPool(device, &createInfo, nullptr, &mvpDescriptorPool_);
 
         if (res != VK_SUCCESS) {
             std::cerr << "Render Failed to create DescriptorPool res: " << res << std::endl;
@@ -412,96 +823,47 @@ namespace render_2d {
         }
     }
 
+    // 动态 uniform 的偏移在绑定时指定，所有帧共用一个描述符集
     void Renderer::allocateDescriptorSets() {
         auto &ctx = Context::GetInstance();
         auto mvpSetLayout = ctx.shader_->GetDescriptorSetLayouts()[0];
-        auto colorSetLayout = ctx.shader_->GetDescriptorSetLayouts()[1];
 
-
-        // 每一个描述符集都需要一个自己的 setLayout
-        std::vector<VkDescriptorSetLayout> colorSetLayouts = std::vector<VkDescriptorSetLayout>(maxFlightCount_,
-                                                                                                colorSetLayout);
-        std::vector<VkDescriptorSetLayout> mvpSetLayouts = std::vector<VkDescriptorSetLayout>(maxFlightCount_,
-                                                                                              mvpSetLayout);
         /* Init MVP DescriptorSet Allocate*/
         VkDescriptorSetAllocateInfo mvpSetAllocateInfo{};
         mvpSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         mvpSetAllocateInfo.descriptorPool = mvpDescriptorPool_;
-        mvpSetAllocateInfo.descriptorSetCount = maxFlightCount_;
-        mvpSetAllocateInfo.pSetLayouts = mvpSetLayouts.data();
-        mvpDescriptorSets_.resize(maxFlightCount_);
-        vkAllocateDescriptorSets(ctx.device_, &mvpSetAllocateInfo, mvpDescriptorSets_.data());
-
-        /* Init Color DescriptorSet Allocate*/
-        VkDescriptorSetAllocateInfo colorSetAllocateInfo{};
-        colorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        colorSetAllocateInfo.descriptorPool = colorDescriptorPool_;
-        colorSetAllocateInfo.descriptorSetCount = maxFlightCount_;
-        colorSetAllocateInfo.pSetLayouts = colorSetLayouts.data();
-        colorDescriptorSets_.resize(maxFlightCount_);
-        vkAllocateDescriptorSets(ctx.device_, &colorSetAllocateInfo, colorDescriptorSets_.data());
-
+        mvpSetAllocateInfo.descriptorSetCount = 1;
+        mvpSetAllocateInfo.pSetLayouts = &mvpSetLayout;
+        vkAllocateDescriptorSets(ctx.device_, &mvpSetAllocateInfo, &mvpDescriptorSet_);
 
         std::cout << "Renderer allocate DescriptorSets success" << std::endl;
     }
 
-    // 将 descriptorSets 和 uniformBuffers 绑定
+    // 将 descriptorSet 和 uniform 环形 buffer 绑定，range 为一个 MVP 的大小
     void Renderer::updateDescriptorSets() {
         auto &ctx = Context::GetInstance();
-        for (size_t i = 0; i < colorDescriptorSets_.size(); i++) {
-            std::vector<VkWriteDescriptorSet> writes{};
-            writes.resize(2);
-
-            auto &mvpSet = mvpDescriptorSets_[i];
-            VkDescriptorBufferInfo vertexBufferInfo{};
-            vertexBufferInfo.buffer = localMVPUniformBufs_[i]->buffer_;
-            vertexBufferInfo.offset = 0;
-            vertexBufferInfo.range = localMVPUniformBufs_[i]->buffer_size_;
-            VkWriteDescriptorSet vertexWrite{};
-            vertexWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            vertexWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            vertexWrite.pBufferInfo = &vertexBufferInfo;
-            vertexWrite.dstBinding = 0;
-            vertexWrite.dstSet = mvpSet;
-            vertexWrite.dstArrayElement = 0; // 绑定uniform数组的哪一个元素 (数组size == 0 则只绑定一个 uniform)
-            vertexWrite.descriptorCount = 1;
-            writes[0] = vertexWrite;
-
-
-            auto &set = colorDescriptorSets_[i];
-            VkDescriptorBufferInfo colorBufferInfo{};
-            colorBufferInfo.buffer = localColorUniformBufs_[i]->buffer_;
-            colorBufferInfo.offset = 0;
-            colorBufferInfo.range = localColorUniformBufs_[i]->buffer_size_;
-            VkWriteDescriptorSet colorWrite{};
-            colorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            colorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            colorWrite.pBufferInfo = &colorBufferInfo;
-            colorWrite.dstBinding = 0;
-            colorWrite.dstSet = set;
-            colorWrite.dstArrayElement = 0; // 绑定uniform数组的哪一个元素 (数组size == 0 则只绑定一个 uniform)
-            colorWrite.descriptorCount = 1;
-            writes[1] = colorWrite;
-            vkUpdateDescriptorSets(ctx.device_, writes.size(), writes.data(),
-                                   0, nullptr);
-        }
-    }
-
-    void Renderer::bufferMVPUniformData(const glm::mat4 modelMat) {
+        VkDescriptorBufferInfo vertexBufferInfo{};
+        vertexBufferInfo.buffer = uniformRing_->GetBuffer();
+        vertexBufferInfo.offset = 0;
+        vertexBufferInfo.range = sizeof(MVP);
+        VkWriteDescriptorSet vertexWrite{};
+        vertexWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        vertexWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        vertexWrite.pBufferInfo = &vertexBufferInfo;
+        vertexWrite.dstBinding = 0;
+        vertexWrite.dstSet = mvpDescriptorSet_;
+        vertexWrite.dstArrayElement = 0; // 绑定uniform数组的哪一个元素 (数组size == 0 则只绑定一个 uniform)
+        vertexWrite.descriptorCount = 1;
+        vkUpdateDescriptorSets(ctx.device_, 1, &vertexWrite, 0, nullptr);
+    }
+
+    // 将 MVP 写入当前帧的 uniform 区域，返回绑定时使用的动态偏移
+    uint32_t Renderer::bufferMVPUniformData(const glm::mat4 modelMat) {
         MVP mvp{};
         mvp.project = projectMat_;
-        mvp.view = viewMat_;;
+        mvp.view = viewMat_;
         mvp.model = modelMat;
-
-        for (size_t i = 0; i < hostMVPUniformBufs_.size(); i++) {
-            auto &buffer = hostMVPUniformBufs_[i];
-
-            if (buffer->map) {
-                memcpy(buffer->map, (void *) &mvp, sizeof(mvp));
-                // 如果持续渲染，不能 vkUnmapMemory(device, buffer->memory_);
-                transformBuffer2Device(*buffer, *localMVPUniformBufs_[i], buffer->buffer_size_, 0, 0);
-            }
-        }
+        return uniformRing_->Push(mvp);
     }
 
     void Renderer::initMats() {
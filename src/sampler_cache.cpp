@@ -0,0 +1,37 @@
+#include "../include/sampler_cache.h"
+
+namespace render_2d {
+    SamplerCache::SamplerCache(VkDevice device) : device_(device) {}
+
+    SamplerCache::~SamplerCache() {
+        for (auto &[key, sampler]: samplers_) {
+            vkDestroySampler(device_, sampler, nullptr);
+        }
+    }
+
+    VkSampler SamplerCache::Get(VkFilter filter, VkSamplerAddressMode addressMode) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto key = std::make_pair(filter, addressMode);
+        auto it = samplers_.find(key);
+        if (it != samplers_.end()) {
+            return it->second;
+        }
+
+        VkSamplerCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        createInfo.magFilter = filter;
+        createInfo.minFilter = filter;
+        createInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST; // 纹理只有一级 mipmap
+        createInfo.addressModeU = addressMode;
+        createInfo.addressModeV = addressMode;
+        createInfo.addressModeW = addressMode;
+        createInfo.maxLod = 0.0f;
+        createInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+        VkSampler sampler;
+        if (vkCreateSampler(device_, &createInfo, nullptr, &sampler) != VK_SUCCESS) {
+            throw std::runtime_error("SamplerCache failed to create sampler");
+        }
+        samplers_.emplace(key, sampler);
+        return sampler;
+    }
+}
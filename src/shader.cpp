@@ -5,7 +5,8 @@
 #include "../include/shader.h"
 
 namespace render_2d {
-    Shader::Shader(const std::string &vertex_source, const std::string &fragment_source, VkDevice &device) {
+    Shader::Shader(const std::string &vertex_source, const std::string &immediate_vertex_source,
+                   const std::string &fragment_source, VkDevice &device, LayoutCache &layoutCache) {
         device_ = device;
         VkShaderModuleCreateInfo vertexShaderCreateInfo{};
         vertexShaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -15,6 +16,13 @@ namespace render_2d {
                              nullptr, &vertexShaderModule_);
         std::cout << "Vertex shader module created successfully." << std::endl;
 
+        VkShaderModuleCreateInfo immediateShaderCreateInfo{};
+        immediateShaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        immediateShaderCreateInfo.codeSize = immediate_vertex_source.size();
+        immediateShaderCreateInfo.pCode = (uint32_t *) immediate_vertex_source.data();
+        vkCreateShaderModule(device_, &immediateShaderCreateInfo,
+                             nullptr, &immediateVertexShaderModule_);
+
         VkShaderModuleCreateInfo fragmentShaderCreateInfo{};
         fragmentShaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
         fragmentShaderCreateInfo.codeSize = fragment_source.size();
@@ -25,16 +33,14 @@ namespace render_2d {
 
         initStages();
 
-        initDescriptorSetLayouts();
+        initLayout(vertex_source, immediate_vertex_source, fragment_source, layoutCache);
     }
 
 
     Shader::~Shader() {
-        for (auto &setLayout: setLayouts_) {
-            vkDestroyDescriptorSetLayout(device_, setLayout, nullptr);
-        }
         vkDestroyShaderModule(device_, fragmentShaderModule_, nullptr);
         vkDestroyShaderModule(device_, vertexShaderModule_, nullptr);
+        vkDestroyShaderModule(device_, immediateVertexShaderModule_, nullptr);
         std::cout << "Shader module destroyed successfully." << std::endl;
     }
 
@@ -43,6 +49,10 @@ namespace render_2d {
         return stages_;
     }
 
+    std::vector<VkPipelineShaderStageCreateInfo> Shader::GetImmediateShaderStages() {
+        return immediateStages_;
+    }
+
     void Shader::initStages() {
         stages_.resize(2);
         VkPipelineShaderStageCreateInfo vertexStage{};
@@ -58,46 +68,29 @@ namespace render_2d {
         fragmentStage.module = fragmentShaderModule_;
         fragmentStage.pName = "main";
         stages_[1] = fragmentStage;
+
+        immediateStages_ = stages_;
+        immediateStages_[0].module = immediateVertexShaderModule_;
         std::cout << "Shader stages initialized successfully." << std::endl;
     }
 
 
-    void Shader::initDescriptorSetLayouts() {
-        setLayouts_.resize(2);
-        /* Init VertexShader MVP Uniform Set = 0 */
-        VkDescriptorSetLayoutBinding vertexLayoutBinding{};
-        vertexLayoutBinding.binding = 0;
-        vertexLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        vertexLayoutBinding.descriptorCount = 1;
-        vertexLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-        VkDescriptorSetLayoutCreateInfo vertexLayoutCreateInfo{};
-        vertexLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        vertexLayoutCreateInfo.bindingCount = 1;
-        vertexLayoutCreateInfo.pBindings = &vertexLayoutBinding;
-        VkDescriptorSetLayout vertexSetLayout{};
-        vkCreateDescriptorSetLayout(device_, &vertexLayoutCreateInfo, nullptr, &vertexSetLayout);
-        setLayouts_[0] = vertexSetLayout;
-
-
-        /* Init FragmentShader Color Uniform Set = 1*/
-        VkDescriptorSetLayoutBinding fragLayoutBinding{};
-        fragLayoutBinding.binding = 0;
-        fragLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        fragLayoutBinding.descriptorCount = 1;
-        fragLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-        VkDescriptorSetLayoutCreateInfo fragLayoutCreateInfo{};
-        fragLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        fragLayoutCreateInfo.bindingCount = 1;
-        fragLayoutCreateInfo.pBindings = &fragLayoutBinding;
-        VkDescriptorSetLayout fragmentSetLayout{};
-        vkCreateDescriptorSetLayout(device_, &fragLayoutCreateInfo, nullptr, &fragmentSetLayout);
-        setLayouts_[1] = fragmentSetLayout;
-
-
-        std::cout << "DescriptorSet layouts initialized successfully. setLayout size -> " << setLayouts_.size()
-                  << std::endl;
+    void Shader::initLayout(const std::string &vertex_source, const std::string &immediate_vertex_source,
+                            const std::string &fragment_source, LayoutCache &layoutCache) {
+        auto vertex = ShaderReflection::Reflect(vertex_source);
+        auto immediateVertex = ShaderReflection::Reflect(immediate_vertex_source);
+        vertexInputs_ = vertex.vertexInputs;
+        immediateVertexInputs_ = immediateVertex.vertexInputs;
+
+        reflection_ = vertex;
+        reflection_.Merge(immediateVertex);
+        reflection_.Merge(ShaderReflection::Reflect(fragment_source));
+        // set = 0 的 MVP 写入每帧的 uniform 环形 buffer，使用动态偏移绑定
+        reflection_.MakeDynamic(0, 0);
+        layout_ = layoutCache.Get(reflection_);
+
+        std::cout << "DescriptorSet layouts initialized successfully. setLayout size -> "
+                  << layout_.setLayouts.size() << std::endl;
     }
 }
 
@@ -0,0 +1,475 @@
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include "../include/shader_reflection.h"
+
+namespace render_2d {
+    namespace {
+        // 只列出反射用到的 SPIR-V 常量 (SPIR-V 规范 3.x 节)
+        constexpr uint32_t kMagicNumber = 0x07230203;
+        constexpr uint32_t kHeaderWords = 5;
+
+        enum Op : uint32_t {
+            OpEntryPoint = 15,
+            OpTypeInt = 21,
+            OpTypeFloat = 22,
+            OpTypeVector = 23,
+            OpTypeMatrix = 24,
+            OpTypeImage = 25,
+            OpTypeSampler = 26,
+            OpTypeSampledImage = 27,
+            OpTypeArray = 28,
+            OpTypeRuntimeArray = 29,
+            OpTypeStruct = 30,
+            OpTypePointer = 32,
+            OpConstant = 43,
+            OpVariable = 59,
+            OpDecorate = 71,
+            OpMemberDecorate = 72
+        };
+
+        enum Decoration : uint32_t {
+            DecorationBlock = 2,
+            DecorationBufferBlock = 3,
+            DecorationArrayStride = 6,
+            DecorationMatrixStride = 7,
+            DecorationBuiltIn = 11,
+            DecorationLocation = 30,
+            DecorationBinding = 33,
+            DecorationDescriptorSet = 34,
+            DecorationOffset = 35
+        };
+
+        enum StorageClass : uint32_t {
+            StorageUniformConstant = 0,
+            StorageInput = 1,
+            StorageUniform = 2,
+            StoragePushConstant = 9,
+            StorageStorageBuffer = 12
+        };
+
+        enum Dim : uint32_t {
+            DimBuffer = 5,
+            DimSubpassData = 6
+        };
+
+        VkShaderStageFlagBits executionModelToStage(uint32_t model) {
+            switch (model) {
+                case 0:
+                    return VK_SHADER_STAGE_VERTEX_BIT;
+                case 1:
+                    return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+                case 2:
+                    return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+                case 3:
+                    return VK_SHADER_STAGE_GEOMETRY_BIT;
+                case 4:
+                    return VK_SHADER_STAGE_FRAGMENT_BIT;
+                case 5:
+                    return VK_SHADER_STAGE_COMPUTE_BIT;
+                default:
+                    throw std::runtime_error("SPIR-V reflection: unsupported execution model " + std::to_string(model));
+            }
+        }
+
+        /**
+         * 一次遍历收集类型、常量、装饰和变量，之后按需查询
+         * 每条指令的第一个 word 为 (wordCount << 16) | opcode
+         */
+        class Module {
+        public:
+            explicit Module(const std::string &spirv) {
+                if (spirv.size() % 4 != 0 || spirv.size() < kHeaderWords * 4) {
+                    throw std::runtime_error("SPIR-V reflection: invalid code size");
+                }
+                std::vector<uint32_t> words(spirv.size() / 4);
+                memcpy(words.data(), spirv.data(), spirv.size());
+                if (words[0] != kMagicNumber) {
+                    throw std::runtime_error("SPIR-V reflection: bad magic number");
+                }
+
+                size_t i = kHeaderWords;
+                while (i < words.size()) {
+                    uint32_t wordCount = words[i] >> 16;
+                    uint32_t opcode = words[i] & 0xffff;
+                    if (wordCount == 0 || i + wordCount > words.size()) {
+                        throw std::runtime_error("SPIR-V reflection: truncated instruction");
+                    }
+                    std::vector<uint32_t> operands(words.begin() + i + 1, words.begin() + i + wordCount);
+                    parse(opcode, operands);
+                    i += wordCount;
+                }
+            }
+
+            struct Instruction {
+                uint32_t opcode;
+                std::vector<uint32_t> operands; // 不包含 result id
+            };
+
+            struct Variable {
+                uint32_t id;
+                uint32_t pointerType;
+                uint32_t storageClass;
+            };
+
+            std::vector<VkShaderStageFlagBits> stages;
+
+            std::vector<Variable> variables;
+
+            const Instruction &Type(uint32_t id) const {
+                auto it = types_.find(id);
+                if (it == types_.end()) {
+                    throw std::runtime_error("SPIR-V reflection: unknown type id " + std::to_string(id));
+                }
+                return it->second;
+            }
+
+            std::optional<uint32_t> Decoration(uint32_t id, uint32_t decoration) const {
+                auto it = decorations_.find(id);
+                if (it == decorations_.end()) {
+                    return std::nullopt;
+                }
+                auto value = it->second.find(decoration);
+                return value == it->second.end() ? std::nullopt : std::optional<uint32_t>(value->second);
+            }
+
+            std::optional<uint32_t> MemberDecoration(uint32_t structId, uint32_t member, uint32_t decoration) const {
+                auto it = memberDecorations_.find(std::make_pair(structId, member));
+                if (it == memberDecorations_.end()) {
+                    return std::nullopt;
+                }
+                auto value = it->second.find(decoration);
+                return value == it->second.end() ? std::nullopt : std::optional<uint32_t>(value->second);
+            }
+
+            uint32_t Constant(uint32_t id) const {
+                auto it = constants_.find(id);
+                if (it == constants_.end()) {
+                    throw std::runtime_error("SPIR-V reflection: array length is not a constant");
+                }
+                return it->second;
+            }
+
+            // 类型在内存中的大小 (用于 push constant 块)，matrixStride 来自所在成员的 MatrixStride 装饰
+            uint32_t TypeSize(uint32_t id, std::optional<uint32_t> matrixStride = std::nullopt) const {
+                auto &type = Type(id);
+                switch (type.opcode) {
+                    case OpTypeInt:
+                    case OpTypeFloat:
+                        return type.operands[0] / 8;
+                    case OpTypeVector:
+                        return type.operands[1] * TypeSize(type.operands[0]);
+                    case OpTypeMatrix:
+                        return type.operands[1] * matrixStride.value_or(TypeSize(type.operands[0]));
+                    case OpTypeArray: {
+                        auto stride = Decoration(id, DecorationArrayStride);
+                        return Constant(type.operands[1]) * stride.value_or(TypeSize(type.operands[0]));
+                    }
+                    case OpTypeStruct: {
+                        uint32_t size = 0;
+                        for (uint32_t member = 0; member < type.operands.size(); member++) {
+                            auto offset = MemberDecoration(id, member, DecorationOffset).value_or(0);
+                            auto memberStride = MemberDecoration(id, member, DecorationMatrixStride);
+                            size = std::max(size, offset + TypeSize(type.operands[member], memberStride));
+                        }
+                        return size;
+                    }
+                    default:
+                        throw std::runtime_error("SPIR-V reflection: cannot size type opcode " +
+                                                 std::to_string(type.opcode));
+                }
+            }
+
+        private:
+            void parse(uint32_t opcode, const std::vector<uint32_t> &operands) {
+                switch (opcode) {
+                    case OpEntryPoint:
+                        stages.push_back(executionModelToStage(operands.at(0)));
+                        break;
+                    case OpTypeInt:
+                    case OpTypeFloat:
+                    case OpTypeVector:
+                    case OpTypeMatrix:
+                    case OpTypeImage:
+                    case OpTypeSampler:
+                    case OpTypeSampledImage:
+                    case OpTypeArray:
+                    case OpTypeRuntimeArray:
+                    case OpTypeStruct:
+                    case OpTypePointer:
+                        types_[operands.at(0)] = Instruction{opcode, {operands.begin() + 1, operands.end()}};
+                        break;
+                    case OpConstant:
+                        // 只需要 32 位整数常量 (数组长度)
+                        constants_[operands.at(1)] = operands.at(2);
+                        break;
+                    case OpVariable:
+                        variables.push_back(Variable{operands.at(1), operands.at(0), operands.at(2)});
+                        break;
+                    case OpDecorate:
+                        decorations_[operands.at(0)][operands.at(1)] = operands.size() > 2 ? operands[2] : 0;
+                        break;
+                    case OpMemberDecorate:
+                        memberDecorations_[std::make_pair(operands.at(0), operands.at(1))][operands.at(2)] =
+                                operands.size() > 3 ? operands[3] : 0;
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            std::unordered_map<uint32_t, Instruction> types_;
+
+            std::unordered_map<uint32_t, uint32_t> constants_;
+
+            std::unordered_map<uint32_t, std::map<uint32_t, uint32_t>> decorations_;
+
+            std::map<std::pair<uint32_t, uint32_t>, std::map<uint32_t, uint32_t>> memberDecorations_;
+        };
+
+        VkDescriptorType descriptorType(const Module &module, uint32_t typeId, uint32_t storageClass) {
+            auto &type = module.Type(typeId);
+            if (storageClass == StorageStorageBuffer) {
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            }
+            if (storageClass == StorageUniform) {
+                // 旧版本 SPIR-V 中的 storage buffer 为 Uniform + BufferBlock
+                return module.Decoration(typeId, DecorationBufferBlock) ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+                                                                         : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            }
+            switch (type.opcode) {
+                case OpTypeSampledImage:
+                    return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                case OpTypeSampler:
+                    return VK_DESCRIPTOR_TYPE_SAMPLER;
+                case OpTypeImage: {
+                    // operands : sampledType, dim, depth, arrayed, ms, sampled (1 采样 / 2 存储), format
+                    auto dim = type.operands.at(1);
+                    auto sampled = type.operands.at(5);
+                    if (dim == DimSubpassData) {
+                        return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                    }
+                    if (dim == DimBuffer) {
+                        return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+                                            : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                    }
+                    return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+                }
+                default:
+                    throw std::runtime_error("SPIR-V reflection: unsupported descriptor type opcode " +
+                                             std::to_string(type.opcode));
+            }
+        }
+
+        // 标量 / 向量输入的格式，只支持 32 位 float / int / uint，矩阵由调用方按列拆开
+        VkFormat vertexInputFormat(const Module &module, uint32_t typeId, uint32_t location) {
+            auto &type = module.Type(typeId);
+            uint32_t componentCount = 1;
+            auto *component = &type;
+            if (type.opcode == OpTypeVector) {
+                componentCount = type.operands[1];
+                component = &module.Type(type.operands[0]);
+            }
+            bool supported = (component->opcode == OpTypeFloat || component->opcode == OpTypeInt) &&
+                             component->operands[0] == 32 && componentCount >= 1 && componentCount <= 4;
+            if (!supported) {
+                throw std::runtime_error("SPIR-V reflection: unsupported vertex input type at location " +
+                                         std::to_string(location));
+            }
+            static const VkFormat floatFormats[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT,
+                                                    VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+            static const VkFormat intFormats[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT,
+                                                  VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+            static const VkFormat uintFormats[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT,
+                                                   VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+            if (component->opcode == OpTypeFloat) {
+                return floatFormats[componentCount - 1];
+            }
+            return component->operands[1] ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+        }
+
+        /**
+         * 同一个 stage 的多个范围合并为一个，之后偏移和大小完全相同的范围合并 stage
+         * (规范要求同一个 stage 只能出现在一个范围中)
+         */
+        std::vector<VkPushConstantRange> normalizePushConstants(const std::vector<VkPushConstantRange> &ranges) {
+            std::map<uint32_t, std::pair<uint32_t, uint32_t>> perStage; // stage bit -> (begin, end)
+            for (auto &range: ranges) {
+                for (uint32_t bit = 1; bit != 0 && bit <= range.stageFlags; bit <<= 1) {
+                    if (!(range.stageFlags & bit)) {
+                        continue;
+                    }
+                    auto it = perStage.find(bit);
+                    if (it == perStage.end()) {
+                        perStage[bit] = {range.offset, range.offset + range.size};
+                    } else {
+                        it->second.first = std::min(it->second.first, range.offset);
+                        it->second.second = std::max(it->second.second, range.offset + range.size);
+                    }
+                }
+            }
+            std::vector<VkPushConstantRange> result;
+            for (auto &[bit, span]: perStage) {
+                auto same = std::find_if(result.begin(), result.end(), [&span](const VkPushConstantRange &range) {
+                    return range.offset == span.first && range.size == span.second - span.first;
+                });
+                if (same != result.end()) {
+                    same->stageFlags |= bit;
+                } else {
+                    result.push_back(VkPushConstantRange{bit, span.first, span.second - span.first});
+                }
+            }
+            return result;
+        }
+    }
+
+    ShaderReflection ShaderReflection::Reflect(const std::string &spirv) {
+        Module module(spirv);
+        ShaderReflection reflection;
+        VkShaderStageFlags stageFlags = 0;
+        for (auto stage: module.stages) {
+            stageFlags |= stage;
+        }
+        reflection.stages = stageFlags;
+
+        for (auto &variable: module.variables) {
+            auto &pointer = module.Type(variable.pointerType);
+            auto typeId = pointer.operands.at(1); // operands : storageClass, type
+
+            switch (variable.storageClass) {
+                case StorageUniformConstant:
+                case StorageUniform:
+                case StorageStorageBuffer: {
+                    auto set = module.Decoration(variable.id, DecorationDescriptorSet);
+                    auto binding = module.Decoration(variable.id, DecorationBinding);
+                    if (!set || !binding) {
+                        break;
+                    }
+                    // 描述符数组：OpTypeArray 的长度为描述符个数，运行时数组记为 1
+                    uint32_t count = 1;
+                    auto &type = module.Type(typeId);
+                    if (type.opcode == OpTypeArray) {
+                        count = module.Constant(type.operands[1]);
+                        typeId = type.operands[0];
+                    } else if (type.opcode == OpTypeRuntimeArray) {
+                        typeId = type.operands[0];
+                    }
+                    reflection.bindings.push_back(DescriptorBinding{
+                            set.value(), binding.value(), descriptorType(module, typeId, variable.storageClass),
+                            count, stageFlags});
+                    break;
+                }
+                case StoragePushConstant: {
+                    // push constant 块从第一个成员的偏移开始
+                    auto &type = module.Type(typeId);
+                    uint32_t offset = UINT32_MAX;
+                    for (uint32_t member = 0; member < type.operands.size(); member++) {
+                        offset = std::min(offset, module.MemberDecoration(typeId, member, DecorationOffset).value_or(0));
+                    }
+                    if (offset == UINT32_MAX) {
+                        break;
+                    }
+                    reflection.pushConstants.push_back(
+                            VkPushConstantRange{stageFlags, offset, module.TypeSize(typeId) - offset});
+                    break;
+                }
+                case StorageInput: {
+                    if (!(stageFlags & VK_SHADER_STAGE_VERTEX_BIT) ||
+                        module.Decoration(variable.id, DecorationBuiltIn)) {
+                        break;
+                    }
+                    auto location = module.Decoration(variable.id, DecorationLocation);
+                    if (!location) {
+                        break;
+                    }
+                    auto &type = module.Type(typeId);
+                    if (type.opcode == OpTypeMatrix) {
+                        // 矩阵输入的每一列占一个连续的 location
+                        for (uint32_t column = 0; column < type.operands[1]; column++) {
+                            auto columnLocation = location.value() + column;
+                            reflection.vertexInputs.push_back(
+                                    VertexInput{columnLocation,
+                                                vertexInputFormat(module, type.operands[0], columnLocation)});
+                        }
+                    } else {
+                        reflection.vertexInputs.push_back(
+                                VertexInput{location.value(), vertexInputFormat(module, typeId, location.value())});
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        std::sort(reflection.bindings.begin(), reflection.bindings.end(),
+                  [](const DescriptorBinding &a, const DescriptorBinding &b) {
+                      return std::make_pair(a.set, a.binding) < std::make_pair(b.set, b.binding);
+                  });
+        std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(),
+                  [](const VertexInput &a, const VertexInput &b) {
+                      return a.location < b.location;
+                  });
+        reflection.pushConstants = normalizePushConstants(reflection.pushConstants);
+        return reflection;
+    }
+
+    void ShaderReflection::Merge(const ShaderReflection &other) {
+        stages |= other.stages;
+        for (auto &binding: other.bindings) {
+            auto it = std::find_if(bindings.begin(), bindings.end(), [&binding](const DescriptorBinding &existing) {
+                return existing.set == binding.set && existing.binding == binding.binding;
+            });
+            if (it == bindings.end()) {
+                bindings.push_back(binding);
+                continue;
+            }
+            if (it->type != binding.type || it->count != binding.count) {
+                throw std::runtime_error("SPIR-V reflection: set " + std::to_string(binding.set) + " binding " +
+                                         std::to_string(binding.binding) + " differs between shaders");
+            }
+            it->stages |= binding.stages;
+        }
+        std::sort(bindings.begin(), bindings.end(), [](const DescriptorBinding &a, const DescriptorBinding &b) {
+            return std::make_pair(a.set, a.binding) < std::make_pair(b.set, b.binding);
+        });
+
+        auto ranges = pushConstants;
+        ranges.insert(ranges.end(), other.pushConstants.begin(), other.pushConstants.end());
+        pushConstants = normalizePushConstants(ranges);
+
+        // vertex 输入只对单个 vertex shader 有意义，合并时保留已有的
+        if (vertexInputs.empty()) {
+            vertexInputs = other.vertexInputs;
+        }
+    }
+
+    void ShaderReflection::MakeDynamic(uint32_t set, uint32_t binding) {
+        for (auto &entry: bindings) {
+            if (entry.set != set || entry.binding != binding) {
+                continue;
+            }
+            if (entry.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+                entry.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            } else if (entry.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
+                entry.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+            }
+        }
+    }
+
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> ShaderReflection::GetSetLayoutBindings() const {
+        std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+        for (auto &entry: bindings) {
+            if (entry.set >= sets.size()) {
+                sets.resize(entry.set + 1);
+            }
+            VkDescriptorSetLayoutBinding binding{};
+            binding.binding = entry.binding;
+            binding.descriptorType = entry.type;
+            binding.descriptorCount = entry.count;
+            binding.stageFlags = entry.stages;
+            sets[entry.set].push_back(binding);
+        }
+        return sets;
+    }
+}
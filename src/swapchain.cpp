@@ -5,12 +5,29 @@
 #include <algorithm>
 #include "../include/swapchain.h"
 #include "../include/context.h"
+#include "../include/cpu_profiler.h"
 
 namespace render_2d {
 
     SwapChain::SwapChain(int width, int height) {
         querySwapChainInfo(width, height);
+        createSwapchain(VK_NULL_HANDLE);
+    }
+
+    SwapChain::SwapChain(int width, int height, uint32_t imageCount) {
+        swapchain = VK_NULL_HANDLE;
+        info.imageExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+        info.imageCount = imageCount;
+        // RGBA 顺序，回读后可以直接写入图片文件
+        info.format = {VK_FORMAT_R8G8B8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+        info.transform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+        info.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        createOffscreenImages();
+        std::cout << "SwapChain offscreen images created " << width << "x" << height << std::endl;
+    }
 
+    void SwapChain::createSwapchain(VkSwapchainKHR oldSwapchain) {
         VkSwapchainCreateInfoKHR createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
         // GPU的图大于屏幕，是否裁切
@@ -19,7 +36,7 @@ namespace render_2d {
         // imageArrayLayers ： 多层的图片数组，可以理解为二维数组 指定1就是不需要3D图像
         createInfo.imageArrayLayers = 1;
         // 图像使用方法 （作为颜色附件）
-        createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        createInfo.imageUsage = info.imageUsage;
         // 图像显示至窗口，颜色如何blending
         createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
         createInfo.surface = Context::GetInstance().surface_;
@@ -34,6 +51,8 @@ namespace render_2d {
         createInfo.presentMode = info.presentMode;
         // preTransform 表示在交换链图像呈现到屏幕上之前，图像应该经历的转换
         createInfo.preTransform = info.transform;
+        // 旧交换链已经提交的 present 可以继续完成，驱动可以复用其资源
+        createInfo.oldSwapchain = oldSwapchain;
 
         // 设置命令队列
         auto &queueFamilyIndices = Context::GetInstance().queueFamilyIndices_;
@@ -47,6 +66,7 @@ namespace render_2d {
                                                queueFamilyIndices.presentQueue.value()};
             // 如果有多个命令队列，设置图像可以被多个 queue 使用
             createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+            createInfo.queueFamilyIndexCount = indices.size();
             createInfo.pQueueFamilyIndices = indices.data();
         }
 
@@ -93,6 +113,11 @@ namespace render_2d {
                   << info.imageExtent.height
                   << std::endl;
 
+        info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        if (capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) {
+            info.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        }
+
         // 图像传递屏幕之前的修改（旋转..）
         info.transform = capabilities.currentTransform;
 
@@ -192,15 +217,116 @@ namespace render_2d {
         std::cout << "SwapChain Create Framebuffers success!" << std::endl;
     }
 
-    SwapChain::~SwapChain() {
-        std::cout << "Destroying SwapChain..." << std::endl;
+    bool SwapChain::Recreate(int width, int height, uint32_t retireFrames) {
+        RENDER2D_PROFILE_SCOPE("swapchain recreate");
+        if (IsOffscreen()) {
+            if (width <= 0 || height <= 0) {
+                return false;
+            }
+            destroyFramebuffers();
+            destroyImageViews();
+            destroyOffscreenImages();
+            info.imageExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+            createOffscreenImages();
+            CreateImageViews();
+            CreateFramebuffers(width, height);
+            return true;
+        }
 
+        // 最小化时不重建，info 必须保持为当前交换链的参数
+        auto saved = info;
+        querySwapChainInfo(width, height);
+        if (info.imageExtent.width == 0 || info.imageExtent.height == 0) {
+            info = saved;
+            return false;
+        }
+        // RenderPass 按原格式创建，保持格式不变才能复用 Pipeline
+        info.format = saved.format;
+
+        destroyFramebuffers();
+        destroyImageViews();
+
+        VkSwapchainKHR oldSwapchain = swapchain;
+        createSwapchain(oldSwapchain);
+        auto &ctx = Context::GetInstance();
+        auto device = ctx.device_;
+        ctx.deletionQueue_->PushAfterFrames(retireFrames, [device, oldSwapchain]() {
+            vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+        });
+
+        getImages();
+        CreateImageViews();
+        CreateFramebuffers(info.imageExtent.width, info.imageExtent.height);
+        return true;
+    }
+
+    // 离屏渲染目标：作为颜色附件渲染，作为拷贝源回读到CPU
+    void SwapChain::createOffscreenImages() {
+        auto &ctx = Context::GetInstance();
+        images.resize(info.imageCount);
+        imageAllocations_.resize(info.imageCount);
+        for (size_t i = 0; i < images.size(); i++) {
+            VkImageCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            createInfo.imageType = VK_IMAGE_TYPE_2D;
+            createInfo.format = info.format.format;
+            createInfo.extent = {info.imageExtent.width, info.imageExtent.height, 1};
+            createInfo.mipLevels = 1;
+            createInfo.arrayLayers = 1;
+            createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            createInfo.usage = info.imageUsage;
+            createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            if (vkCreateImage(ctx.device_, &createInfo, nullptr, &images[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create offscreen image!");
+            }
+
+            VkMemoryRequirements requirements;
+            vkGetImageMemoryRequirements(ctx.device_, images[i], &requirements);
+            auto index = ctx.FindMemoryType(requirements.memoryTypeBits, MemoryPreference::GpuOnly());
+            if (!index) {
+                throw std::runtime_error("failed to find memory type for offscreen image!");
+            }
+            imageAllocations_[i] = ctx.memoryAllocator_->Allocate(requirements, index.value(),
+                                                                  MemoryAllocator::ResourceKind::Optimal);
+            vkBindImageMemory(ctx.device_, images[i], imageAllocations_[i].memory, imageAllocations_[i].offset);
+        }
+    }
+
+    void SwapChain::destroyOffscreenImages() {
+        auto &ctx = Context::GetInstance();
+        for (size_t i = 0; i < images.size(); i++) {
+            vkDestroyImage(ctx.device_, images[i], nullptr);
+            ctx.memoryAllocator_->Free(imageAllocations_[i]);
+        }
+        images.clear();
+        imageAllocations_.clear();
+    }
+
+    void SwapChain::destroyImageViews() {
         for (auto &imageView: imageViews) {
             vkDestroyImageView(Context::GetInstance().device_, imageView, nullptr);
         }
+        imageViews.clear();
+    }
+
+    void SwapChain::destroyFramebuffers() {
         for (auto &frameBuffer: framebuffers) {
             vkDestroyFramebuffer(Context::GetInstance().device_, frameBuffer, nullptr);
         }
-        vkDestroySwapchainKHR(Context::GetInstance().device_, swapchain, nullptr);
+        framebuffers.clear();
+    }
+
+    SwapChain::~SwapChain() {
+        std::cout << "Destroying SwapChain..." << std::endl;
+
+        destroyImageViews();
+        destroyFramebuffers();
+        if (IsOffscreen()) {
+            destroyOffscreenImages();
+        } else {
+            vkDestroySwapchainKHR(Context::GetInstance().device_, swapchain, nullptr);
+        }
     }
 }
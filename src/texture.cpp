@@ -0,0 +1,123 @@
+#include "../include/texture.h"
+#include "../include/context.h"
+#include "../stb_image/stb_image.h"
+
+namespace render_2d {
+    Texture::Texture(const std::string &path, VkFilter filter) {
+        int width, height, channels;
+        auto pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("Texture failed to load " + path + ": " + stbi_failure_reason());
+        }
+        width_ = static_cast<uint32_t>(width);
+        height_ = static_cast<uint32_t>(height);
+        createImage();
+        createImageView();
+        createDescriptorSet(filter);
+        // 像素已经拷贝进 staging，可以立即释放
+        upload(pixels);
+        stbi_image_free(pixels);
+        std::cout << "Texture loaded " << path << " " << width_ << "x" << height_ << std::endl;
+    }
+
+    Texture::Texture(uint32_t width, uint32_t height, const void *pixels, VkFilter filter)
+            : width_(width), height_(height) {
+        createImage();
+        createImageView();
+        createDescriptorSet(filter);
+        upload(pixels);
+    }
+
+    // 在途的帧可能仍在采样该纹理，交给延迟销毁队列
+    Texture::~Texture() {
+        auto &ctx = Context::GetInstance();
+        auto device = ctx.device_;
+        auto descriptorSet = descriptorSet_;
+        auto descriptors = ctx.textureDescriptors_;
+        auto view = view_;
+        auto image = image_;
+        auto allocation = allocation_;
+        auto allocator = ctx.memoryAllocator_;
+        ctx.deletionQueue_->Push([device, descriptorSet, descriptors, view, image, allocation, allocator] {
+            descriptors->Free(descriptorSet);
+            vkDestroyImageView(device, view, nullptr);
+            vkDestroyImage(device, image, nullptr);
+            allocator->Free(allocation);
+        });
+    }
+
+    void Texture::createImage() {
+        auto &ctx = Context::GetInstance();
+        VkImageCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        createInfo.imageType = VK_IMAGE_TYPE_2D;
+        createInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        createInfo.extent = {width_, height_, 1};
+        createInfo.mipLevels = 1;
+        createInfo.arrayLayers = 1;
+        createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        createInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (vkCreateImage(ctx.device_, &createInfo, nullptr, &image_) != VK_SUCCESS) {
+            throw std::runtime_error("Texture failed to create image");
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(ctx.device_, image_, &requirements);
+        auto index = ctx.FindMemoryType(requirements.memoryTypeBits, MemoryPreference::GpuOnly());
+        if (!index) {
+            throw std::runtime_error("Texture failed to find a suitable memory type");
+        }
+        allocation_ = ctx.memoryAllocator_->Allocate(requirements, index.value(),
+                                                     MemoryAllocator::ResourceKind::Optimal);
+        vkBindImageMemory(ctx.device_, image_, allocation_.memory, allocation_.offset);
+    }
+
+    void Texture::createImageView() {
+        VkImageViewCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        createInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        createInfo.image = image_;
+        createInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        if (vkCreateImageView(Context::GetInstance().device_, &createInfo, nullptr, &view_) != VK_SUCCESS) {
+            throw std::runtime_error("Texture failed to create image view");
+        }
+    }
+
+    // 每个纹理一个描述符集，从 Context 共享的描述符池中分配，内容创建后不再改变，绘制时直接绑定到 set = 1
+    void Texture::createDescriptorSet(VkFilter filter) {
+        auto &ctx = Context::GetInstance();
+        descriptorSet_ = ctx.textureDescriptors_->Allocate(ctx.shader_->GetDescriptorSetLayouts()[1]);
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = ctx.samplerCache_->Get(filter, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+        imageInfo.imageView = view_;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptorSet_.set;
+        write.dstBinding = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.descriptorCount = 1;
+        write.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(ctx.device_, 1, &write, 0, nullptr);
+    }
+
+    void Texture::Update(const void *pixels, VkOffset2D offset, VkExtent2D extent) {
+        assert(offset.x >= 0 && offset.y >= 0 && offset.x + extent.width <= width_ &&
+               offset.y + extent.height <= height_);
+        uint64_t size = static_cast<uint64_t>(extent.width) * extent.height * 4;
+        // 构造时已经登记过整张图的上传，之后图像总是处于 SHADER_READ_ONLY_OPTIMAL
+        Context::GetInstance().uploadManager_->UploadImage(image_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, pixels,
+                                                           size, offset, extent);
+    }
+
+    void Texture::upload(const void *pixels) {
+        uint64_t size = static_cast<uint64_t>(width_) * height_ * 4;
+        Context::GetInstance().uploadManager_->UploadImage(image_, VK_IMAGE_LAYOUT_UNDEFINED, pixels, size, {0, 0},
+                                                           {width_, height_});
+    }
+}
@@ -0,0 +1,90 @@
+#include "../include/texture_atlas.h"
+#include "../stb_image/stb_image.h"
+
+namespace render_2d {
+    TextureAtlas::TextureAtlas(uint32_t pageSize, VkFilter filter, uint32_t padding)
+            : pageSize_(pageSize), padding_(padding), filter_(filter) {}
+
+    TextureAtlas::~TextureAtlas() {
+        pages_.clear();
+    }
+
+    std::optional<AtlasRegion> TextureAtlas::Add(uint32_t width, uint32_t height, const void *pixels) {
+        if (width == 0 || height == 0 || width + 2 * padding_ > pageSize_ || height + 2 * padding_ > pageSize_) {
+            std::cerr << "TextureAtlas image " << width << "x" << height << " does not fit in page " << pageSize_
+                      << std::endl;
+            return std::nullopt;
+        }
+
+        // 先尝试已有的页，都放不下时新建一页
+        uint32_t x = 0, y = 0;
+        uint32_t pageIndex = 0;
+        for (; pageIndex < pages_.size(); pageIndex++) {
+            if (pack(*pages_[pageIndex], width + 2 * padding_, height + 2 * padding_, x, y)) {
+                break;
+            }
+        }
+        if (pageIndex == pages_.size()) {
+            auto &page = createPage();
+            if (!pack(page, width + 2 * padding_, height + 2 * padding_, x, y)) {
+                return std::nullopt;
+            }
+        }
+        x += padding_;
+        y += padding_;
+
+        auto &texture = *pages_[pageIndex]->texture;
+        texture.Update(pixels, {static_cast<int32_t>(x), static_cast<int32_t>(y)}, {width, height});
+
+        auto size = static_cast<float>(pageSize_);
+        AtlasRegion region{};
+        region.texture = &texture;
+        region.uvRect = glm::vec4(x / size, y / size, (x + width) / size, (y + height) / size);
+        region.page = pageIndex;
+        region.x = x;
+        region.y = y;
+        region.width = width;
+        region.height = height;
+        return region;
+    }
+
+    std::optional<AtlasRegion> TextureAtlas::AddFile(const std::string &path) {
+        int width, height, channels;
+        auto pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels) {
+            std::cerr << "TextureAtlas failed to load " << path << ": " << stbi_failure_reason() << std::endl;
+            return std::nullopt;
+        }
+        // 像素在 Add 中已经拷贝进 staging
+        auto region = Add(static_cast<uint32_t>(width), static_cast<uint32_t>(height), pixels);
+        stbi_image_free(pixels);
+        return region;
+    }
+
+    // 新页初始化为全透明，padding 区域采样到的是透明像素
+    TextureAtlas::Page &TextureAtlas::createPage() {
+        auto page = std::make_unique<Page>();
+        std::vector<uint8_t> clear(static_cast<size_t>(pageSize_) * pageSize_ * 4, 0);
+        page->texture = std::make_unique<Texture>(pageSize_, pageSize_, clear.data(), filter_);
+        // 节点数不少于页面宽度时 stb_rect_pack 的结果最优
+        page->nodes.resize(pageSize_);
+        stbrp_init_target(&page->context, static_cast<int>(pageSize_), static_cast<int>(pageSize_),
+                          page->nodes.data(), static_cast<int>(page->nodes.size()));
+        pages_.push_back(std::move(page));
+        std::cout << "TextureAtlas create page " << pages_.size() - 1 << " size " << pageSize_ << std::endl;
+        return *pages_.back();
+    }
+
+    bool TextureAtlas::pack(Page &page, uint32_t width, uint32_t height, uint32_t &x, uint32_t &y) {
+        stbrp_rect rect{};
+        rect.w = static_cast<stbrp_coord>(width);
+        rect.h = static_cast<stbrp_coord>(height);
+        stbrp_pack_rects(&page.context, &rect, 1);
+        if (!rect.was_packed) {
+            return false;
+        }
+        x = static_cast<uint32_t>(rect.x);
+        y = static_cast<uint32_t>(rect.y);
+        return true;
+    }
+}
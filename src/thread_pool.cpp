@@ -0,0 +1,58 @@
+#include "../include/thread_pool.h"
+
+namespace render_2d {
+    ThreadPool::ThreadPool(uint32_t threadCount) {
+        threads_.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++) {
+            threads_.emplace_back(&ThreadPool::run, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        for (auto &thread: threads_) {
+            thread.join();
+        }
+    }
+
+    void ThreadPool::ParallelFor(uint32_t count, const Task &task) {
+        if (count == 0) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        task_ = &task;
+        count_ = count;
+        next_ = 0;
+        finished_ = 0;
+        generation_++;
+        cond_.notify_all();
+        doneCond_.wait(lock, [this] { return finished_ == count_; });
+        task_ = nullptr;
+    }
+
+    void ThreadPool::run(uint32_t thread) {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cond_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+            // 抢占式领取任务，执行任务时不持有锁
+            while (next_ < count_) {
+                uint32_t index = next_++;
+                lock.unlock();
+                (*task_)(index, thread);
+                lock.lock();
+                if (++finished_ == count_) {
+                    doneCond_.notify_one();
+                }
+            }
+        }
+    }
+}
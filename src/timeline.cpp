@@ -0,0 +1,98 @@
+#include <limits>
+#include "../include/timeline.h"
+
+namespace render_2d {
+    Timeline::Timeline(VkDevice device) : device_(device) {
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+        VkSemaphoreCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        createInfo.pNext = &typeInfo;
+        if (vkCreateSemaphore(device_, &createInfo, nullptr, &semaphore_) != VK_SUCCESS) {
+            throw std::runtime_error("Timeline failed to create timeline semaphore");
+        }
+    }
+
+    Timeline::~Timeline() {
+        vkDestroySemaphore(device_, semaphore_, nullptr);
+    }
+
+    VkResult Timeline::Submit(VkQueue queue, const VkSubmitInfo &submitInfo, uint64_t &value,
+                              const std::vector<WaitPoint> &waits) {
+        std::vector<VkSemaphore> signalSemaphores(submitInfo.pSignalSemaphores,
+                                                  submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+        signalSemaphores.push_back(semaphore_);
+        // binary semaphore 的值会被忽略，但值数组的长度必须与信号量个数一致
+        std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+        signalValues.back() = lastSubmitted_.load() + 1;
+        std::vector<VkSemaphore> waitSemaphores(submitInfo.pWaitSemaphores,
+                                                submitInfo.pWaitSemaphores + submitInfo.waitSemaphoreCount);
+        std::vector<VkPipelineStageFlags> waitStages(submitInfo.pWaitDstStageMask,
+                                                     submitInfo.pWaitDstStageMask + submitInfo.waitSemaphoreCount);
+        std::vector<uint64_t> waitValues(submitInfo.waitSemaphoreCount, 0);
+        for (auto &wait: waits) {
+            waitSemaphores.push_back(wait.timeline->semaphore_);
+            waitStages.push_back(wait.stage);
+            waitValues.push_back(wait.value);
+        }
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.pNext = submitInfo.pNext;
+        timelineInfo.waitSemaphoreValueCount = waitValues.size();
+        timelineInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineInfo.signalSemaphoreValueCount = signalValues.size();
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+        auto submit = submitInfo;
+        submit.pNext = &timelineInfo;
+        submit.waitSemaphoreCount = waitSemaphores.size();
+        submit.pWaitSemaphores = waitSemaphores.data();
+        submit.pWaitDstStageMask = waitStages.data();
+        submit.signalSemaphoreCount = signalSemaphores.size();
+        submit.pSignalSemaphores = signalSemaphores.data();
+        auto res = vkQueueSubmit(queue, 1, &submit, VK_NULL_HANDLE);
+        // 提交失败时值不会被 signal，不能计入 lastSubmitted_，否则等待它会永远阻塞
+        if (res == VK_SUCCESS) {
+            value = signalValues.back();
+            lastSubmitted_.store(value);
+        }
+        return res;
+    }
+
+    uint64_t Timeline::Completed() {
+        uint64_t value = 0;
+        if (vkGetSemaphoreCounterValue(device_, semaphore_, &value) != VK_SUCCESS) {
+            throw std::runtime_error("Timeline failed to query semaphore counter");
+        }
+        advance(value);
+        return value;
+    }
+
+    bool Timeline::IsComplete(uint64_t value) {
+        return value <= completed_.load() || value <= Completed();
+    }
+
+    void Timeline::Wait(uint64_t value) {
+        if (value <= completed_.load()) {
+            return;
+        }
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &semaphore_;
+        waitInfo.pValues = &value;
+        if (vkWaitSemaphores(device_, &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+            throw std::runtime_error("Timeline failed to wait semaphore");
+        }
+        advance(value);
+    }
+
+    // 并发的查询 / 等待可能已经更新到更大的值，completed_ 只增不减
+    void Timeline::advance(uint64_t value) {
+        auto completed = completed_.load();
+        while (completed < value && !completed_.compare_exchange_weak(completed, value)) {}
+    }
+}
@@ -2,8 +2,23 @@
 #include <fstream>
 #include <string>
 #include <stdexcept>
+// stb 的实现统一放在这个编译单元中
+#define STB_IMAGE_IMPLEMENTATION
+
 #include "../stb_image/stb_image.h"
 
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "../stb_image/stb_image_write.h"
+
+#define STB_RECT_PACK_IMPLEMENTATION
+
+#include "../stb_image/stb_rect_pack.h"
+
+#define STB_TRUETYPE_IMPLEMENTATION
+
+#include "../stb_image/stb_truetype.h"
+
 namespace render_2d {
 
     std::string ReadWholeFile(const std::string &filename) {
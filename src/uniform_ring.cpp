@@ -0,0 +1,37 @@
+#include "../include/uniform_ring.h"
+
+namespace render_2d {
+    UniformRing::UniformRing(uint64_t frameSize, uint32_t frameCount, VkDevice device, VkPhysicalDevice gpu) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(gpu, &properties);
+        alignment_ = properties.limits.minUniformBufferOffsetAlignment;
+        // 每帧区域的起点也要满足动态偏移的对齐要求
+        frameSize_ = (frameSize + alignment_ - 1) / alignment_ * alignment_;
+
+        // 有 ReBAR 时落在 DEVICE_LOCAL|HOST_VISIBLE 内存上，GPU 读取不需要经过 PCIe
+        buffer_ = std::make_unique<Buffer>(frameSize_ * frameCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                           MemoryPreference::Streaming(), device);
+        std::cout << "UniformRing created, frame size -> " << frameSize_ << " frame count -> " << frameCount
+                  << std::endl;
+    }
+
+    UniformRing::~UniformRing() {
+        buffer_.reset();
+    }
+
+    void UniformRing::BeginFrame(uint32_t frame) {
+        frameBegin_ = frame * frameSize_;
+        head_ = frameBegin_;
+    }
+
+    uint32_t UniformRing::Push(const void *data, uint64_t size) {
+        if (head_ + size > frameBegin_ + frameSize_) {
+            throw std::runtime_error("UniformRing frame region overflow");
+        }
+        auto offset = head_;
+        // HOST_COHERENT 内存，写完不需要 vkFlushMappedMemoryRanges
+        memcpy(static_cast<char *>(buffer_->map) + offset, data, size);
+        head_ = (head_ + size + alignment_ - 1) / alignment_ * alignment_;
+        return static_cast<uint32_t>(offset);
+    }
+}
@@ -0,0 +1,490 @@
+#include <algorithm>
+#include "../include/upload_manager.h"
+#include "../include/cpu_profiler.h"
+
+namespace render_2d {
+    // staging 中每次上传的起始偏移对齐 (满足后续 buffer -> image 拷贝的 texel 对齐)
+    constexpr uint64_t kStagingAlignment = 16;
+
+    // 小于该大小的上传放在图像队列上，额外的一次提交和所有权转移不划算
+    constexpr uint64_t kTransferQueueMinSize = 64 * 1024;
+
+    // 拷贝结果可能被之后的哪些读写访问
+    constexpr VkAccessFlags kUploadConsumerAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                                    VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+                                                    VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    constexpr VkPipelineStageFlags kUploadConsumerStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                                                           VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                                           VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    UploadManager::UploadManager(uint64_t stagingSize, const Queue &graphics, const std::optional<Queue> &transfer,
+                                 VkDevice device) : device_(device) {
+        graphics_ = createLane(graphics);
+        stagingQueueFamilies_.push_back(graphics.familyIndex);
+        if (transfer) {
+            transfer_ = createLane(transfer.value());
+            stagingQueueFamilies_.push_back(transfer->familyIndex);
+        }
+
+        staging_ = std::make_unique<Buffer>(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                            MemoryPreference::Staging(), device_, stagingQueueFamilies_);
+        std::cout << "UploadManager created, staging size -> " << stagingSize
+                  << (transfer_ ? ", using dedicated transfer queue" : "") << std::endl;
+    }
+
+    UploadManager::~UploadManager() {
+        Flush();
+        while (!inFlight_.empty()) {
+            retire(true);
+        }
+        // 销毁 pool 时会释放所有 commandBuffer
+        vkDestroyCommandPool(device_, graphics_.pool, nullptr);
+        if (transfer_) {
+            vkDestroyCommandPool(device_, transfer_->pool, nullptr);
+        }
+        staging_.reset();
+        std::cout << "UploadManager destroyed" << std::endl;
+    }
+
+    UploadManager::Lane UploadManager::createLane(const Queue &queue) {
+        Lane lane{};
+        lane.queue = queue;
+        VkCommandPoolCreateInfo poolCreateInfo{};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        // 上传用的 commandBuffer 生命周期短且会被复用
+        poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolCreateInfo.queueFamilyIndex = queue.familyIndex;
+        if (vkCreateCommandPool(device_, &poolCreateInfo, nullptr, &lane.pool) != VK_SUCCESS) {
+            throw std::runtime_error("UploadManager failed to create command pool");
+        }
+        return lane;
+    }
+
+    UploadManager::Lane &UploadManager::selectLane(bool wholeResource, uint64_t size) {
+        if (transfer_ && wholeResource && size >= kTransferQueueMinSize) {
+            return transfer_.value();
+        }
+        return graphics_;
+    }
+
+    UploadManager::Token UploadManager::Upload(Buffer &dst, const void *data, uint64_t size, uint64_t dstOffset) {
+        // 同一批次内对同一区域的重复写入不能放在同一个 vkCmdCopyBuffer 中，先提交之前的拷贝
+        if (overlapsPending(dst.buffer_, dstOffset, size)) {
+            Flush();
+        }
+
+        VkBufferCopy region{};
+        region.dstOffset = dstOffset;
+        region.size = size;
+        VkBuffer src = stage(data, size, region.srcOffset);
+
+        // 同一 src -> dst 的拷贝合并为一次 vkCmdCopyBuffer 的多个 region
+        auto &pending = selectLane(dstOffset == 0 && size == dst.buffer_size_, size).buffers;
+        if (!pending.empty() && pending.back().src == src && pending.back().dst == &dst) {
+            pending.back().regions.push_back(region);
+        } else {
+            pending.push_back(CopyGroup{src, &dst, {region}});
+        }
+        return nextToken_;
+    }
+
+    UploadManager::Token UploadManager::UploadImage(VkImage dst, VkImageLayout oldLayout, const void *data,
+                                                    uint64_t size, VkOffset2D offset, VkExtent2D extent) {
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {offset.x, offset.y, 0};
+        region.imageExtent = {extent.width, extent.height, 1};
+
+        // 同一批次中同一图像的拷贝必须来自同一个 staging buffer 且互不重叠，否则先提交之前的拷贝
+        bool wasPending = false;
+        if (auto group = findImageGroup(dst)) {
+            wasPending = true;
+            bool conflict = size > staging_->buffer_size_ || group->src != staging_->buffer_;
+            for (auto &other: group->regions) {
+                conflict = conflict ||
+                           (offset.x < other.imageOffset.x + static_cast<int32_t>(other.imageExtent.width) &&
+                            other.imageOffset.x < offset.x + static_cast<int32_t>(extent.width) &&
+                            offset.y < other.imageOffset.y + static_cast<int32_t>(other.imageExtent.height) &&
+                            other.imageOffset.y < offset.y + static_cast<int32_t>(extent.height));
+            }
+            if (conflict) {
+                Flush();
+            }
+        }
+
+        VkBuffer src = stage(data, size, region.bufferOffset);
+
+        // 已有的组在哪个队列上，之后同一图像的拷贝也跟着它
+        auto group = findImageGroup(dst);
+        if (group && group->src == src) {
+            group->regions.push_back(region);
+        } else {
+            // 之前的拷贝已经提交，图像在该批次结束时已是 SHADER_READ_ONLY_OPTIMAL
+            auto layout = wasPending ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : oldLayout;
+            // UNDEFINED 表示不保留原内容，新图像第一次使用时不需要从图像队列转移所有权
+            auto &lane = selectLane(layout == VK_IMAGE_LAYOUT_UNDEFINED, size);
+            lane.images.push_back(ImageCopyGroup{src, dst, layout, {region}});
+        }
+        return nextToken_;
+    }
+
+    VkBuffer UploadManager::stage(const void *data, uint64_t size, uint64_t &srcOffset) {
+        if (size > staging_->buffer_size_) {
+            // 超过环形 buffer 的大小，单独创建 staging buffer，随该批次一起回收
+            auto dedicated = std::make_unique<Buffer>(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                      MemoryPreference::Staging(), device_, stagingQueueFamilies_);
+            memcpy(dedicated->map, data, size);
+            srcOffset = 0;
+            auto src = dedicated->buffer_;
+            pendingDedicated_.push_back(std::move(dedicated));
+            return src;
+        }
+        srcOffset = allocateStaging(size);
+        memcpy(static_cast<char *>(staging_->map) + srcOffset, data, size);
+        return staging_->buffer_;
+    }
+
+    UploadManager::Token UploadManager::Flush(GpuProfiler *profiler) {
+        if (!hasPending()) {
+            return nextToken_ - 1;
+        }
+        RENDER2D_PROFILE_SCOPE("upload flush");
+
+        Submission submission{nextToken_, 0, {}, head_, std::move(pendingDedicated_)};
+        pendingDedicated_.clear();
+        // 两个队列上的拷贝互不重叠 (冲突的拷贝已经提前 Flush)，提交顺序无关
+        if (transfer_ && hasPending(transfer_.value())) {
+            submitTransfer(submission);
+        }
+        if (hasPending(graphics_)) {
+            submitGraphics(submission, profiler);
+        }
+        inFlight_.push_back(std::move(submission));
+        return nextToken_++;
+    }
+
+    void UploadManager::submitGraphics(Submission &submission, GpuProfiler *profiler) {
+        auto cmd = acquireCmd(graphics_);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cmd, &beginInfo);
+        int scope = profiler ? profiler->Begin(cmd, "upload") : -1;
+
+        // 之前提交的绘制可能还在读取目标 buffer / 图像，拷贝前先等待这些读取完成 (write-after-read)
+        recordImageBarriers(cmd, graphics_, true);
+        recordCopies(cmd, graphics_);
+
+        // 同一队列之后提交的绘制/拷贝都能看到本批次写入的数据，不需要额外的 semaphore
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = kUploadConsumerAccess;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, kUploadConsumerStages, 0,
+                             1, &barrier, 0, nullptr, 0, nullptr);
+        recordImageBarriers(cmd, graphics_, false);
+        if (profiler) {
+            profiler->End(cmd, scope);
+        }
+        vkEndCommandBuffer(cmd);
+
+        VkSubmitInfo submit{};
+        submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit.commandBufferCount = 1;
+        submit.pCommandBuffers = &cmd;
+        if (graphics_.queue.timeline->Submit(graphics_.queue.queue, submit, submission.timelineValue) != VK_SUCCESS) {
+            throw std::runtime_error("UploadManager failed to submit upload batch");
+        }
+        submission.cmds.emplace_back(&graphics_, cmd);
+        for (auto &group: graphics_.buffers) {
+            group.dst->lastGraphicsUse_ = submission.timelineValue;
+        }
+        graphics_.buffers.clear();
+        graphics_.images.clear();
+    }
+
+    /**
+     * 传输队列：拷贝后 release 所有权 -> 图像队列等待传输队列时间线后 acquire 所有权
+     * 传输队列只支持 TRANSFER 阶段，布局转换 TRANSFER_DST -> SHADER_READ_ONLY 随所有权转移一起完成
+     */
+    void UploadManager::submitTransfer(Submission &submission) {
+        auto &transfer = transfer_.value();
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        auto cmd = acquireCmd(transfer);
+        vkBeginCommandBuffer(cmd, &beginInfo);
+        recordImageBarriers(cmd, transfer, true);
+        recordCopies(cmd, transfer);
+        recordOwnershipBarriers(cmd, transfer, true);
+        vkEndCommandBuffer(cmd);
+
+        // 整块覆盖的 buffer 可能正被之前的帧读取，传输队列在 GPU 上只等待最后访问这些 buffer 的提交 (CPU 不等待)
+        // 还没有被访问过的新 buffer 不需要等待，拷贝与图像队列上的渲染并行执行
+        std::vector<Timeline::WaitPoint> waits;
+        auto &graphicsTimeline = graphics_.queue.timeline;
+        uint64_t lastUse = 0;
+        for (auto &group: transfer.buffers) {
+            lastUse = std::max(lastUse, group.dst->lastGraphicsUse_);
+        }
+        if (lastUse > 0) {
+            waits.push_back({graphicsTimeline.get(), lastUse, VK_PIPELINE_STAGE_TRANSFER_BIT});
+        }
+        VkSubmitInfo submit{};
+        submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit.commandBufferCount = 1;
+        submit.pCommandBuffers = &cmd;
+        uint64_t transferValue;
+        if (transfer.queue.timeline->Submit(transfer.queue.queue, submit, transferValue, waits) != VK_SUCCESS) {
+            throw std::runtime_error("UploadManager failed to submit transfer batch");
+        }
+        submission.cmds.emplace_back(&transfer, cmd);
+
+        auto acquire = acquireCmd(graphics_);
+        vkBeginCommandBuffer(acquire, &beginInfo);
+        recordOwnershipBarriers(acquire, transfer, false);
+        vkEndCommandBuffer(acquire);
+
+        submit.pCommandBuffers = &acquire;
+        waits = {{transfer.queue.timeline.get(), transferValue, VK_PIPELINE_STAGE_TRANSFER_BIT}};
+        if (graphicsTimeline->Submit(graphics_.queue.queue, submit, submission.timelineValue, waits) != VK_SUCCESS) {
+            throw std::runtime_error("UploadManager failed to submit ownership acquire");
+        }
+        submission.cmds.emplace_back(&graphics_, acquire);
+        // 之后再次整块覆盖时至少要等到本次的 acquire 完成
+        for (auto &group: transfer.buffers) {
+            group.dst->lastGraphicsUse_ = submission.timelineValue;
+        }
+        transfer.buffers.clear();
+        transfer.images.clear();
+    }
+
+    void UploadManager::recordCopies(VkCommandBuffer cmd, const Lane &lane) {
+        for (auto &group: lane.buffers) {
+            vkCmdCopyBuffer(cmd, group.src, group.dst->buffer_, group.regions.size(), group.regions.data());
+        }
+        for (auto &group: lane.images) {
+            vkCmdCopyBufferToImage(cmd, group.src, group.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   group.regions.size(), group.regions.data());
+        }
+    }
+
+    /**
+     * beforeCopy : oldLayout -> TRANSFER_DST (等待之前的片元着色器读取)，同时作为 buffer 的 WAR 执行依赖
+     * !beforeCopy : TRANSFER_DST -> SHADER_READ_ONLY，拷贝写入对片元着色器可见
+     * 传输队列上只有新图像 (UNDEFINED)，不需要等待之前的读取
+     */
+    void UploadManager::recordImageBarriers(VkCommandBuffer cmd, const Lane &lane, bool beforeCopy) {
+        std::vector<VkImageMemoryBarrier> barriers;
+        barriers.reserve(lane.images.size());
+        for (auto &group: lane.images) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = group.dst;
+            barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            if (beforeCopy) {
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.oldLayout = group.oldLayout;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            } else {
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            }
+            barriers.push_back(barrier);
+        }
+
+        if (&lane != &graphics_) {
+            if (!barriers.empty()) {
+                vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                     0, nullptr, 0, nullptr, barriers.size(), barriers.data());
+            }
+        } else if (beforeCopy) {
+            vkCmdPipelineBarrier(cmd,
+                                 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                 0, nullptr, 0, nullptr, barriers.size(), barriers.data());
+        } else if (!barriers.empty()) {
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                                 0, nullptr, 0, nullptr, barriers.size(), barriers.data());
+        }
+    }
+
+    // release 与 acquire 的 barrier 参数 (队列族、布局、范围) 必须完全一致
+    void UploadManager::recordOwnershipBarriers(VkCommandBuffer cmd, const Lane &lane, bool release) {
+        auto srcFamily = lane.queue.familyIndex;
+        auto dstFamily = graphics_.queue.familyIndex;
+        auto srcAccess = release ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+        auto dstAccess = release ? 0 : kUploadConsumerAccess;
+
+        std::vector<VkBufferMemoryBarrier> bufferBarriers;
+        for (auto &group: lane.buffers) {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = dstAccess;
+            barrier.srcQueueFamilyIndex = srcFamily;
+            barrier.dstQueueFamilyIndex = dstFamily;
+            barrier.buffer = group.dst->buffer_;
+            barrier.size = VK_WHOLE_SIZE;
+            bufferBarriers.push_back(barrier);
+        }
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+        for (auto &group: lane.images) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = dstAccess;
+            barrier.srcQueueFamilyIndex = srcFamily;
+            barrier.dstQueueFamilyIndex = dstFamily;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.image = group.dst;
+            barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            imageBarriers.push_back(barrier);
+        }
+
+        // acquire 的源阶段与 semaphore 等待阶段相同，构成执行依赖链
+        auto dstStages = release ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : kUploadConsumerStages;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, 0, nullptr,
+                             bufferBarriers.size(), bufferBarriers.data(),
+                             imageBarriers.size(), imageBarriers.data());
+    }
+
+    bool UploadManager::IsComplete(Token token) {
+        retire(false);
+        return token <= completedToken_;
+    }
+
+    void UploadManager::Wait(Token token) {
+        if (token >= nextToken_) {
+            Flush();
+        }
+        while (completedToken_ < token && !inFlight_.empty()) {
+            retire(true);
+        }
+    }
+
+    /**
+     * 在环形 buffer 中分配一段连续空间，返回物理偏移
+     * 空间不足时回收已完成的批次，必要时提交当前批次并等待最早的批次
+     */
+    uint64_t UploadManager::allocateStaging(uint64_t size) {
+        auto capacity = staging_->buffer_size_;
+        while (true) {
+            if (inFlight_.empty() && !hasPending()) {
+                // 环形 buffer 已经为空，从头开始
+                head_ = tail_ = 0;
+            }
+            uint64_t begin = alignUp(head_, kStagingAlignment);
+            if (begin % capacity + size > capacity) {
+                // 尾部剩余空间不够，跳到下一圈的起点
+                begin = alignUp(begin, capacity);
+            }
+            if (begin + size - tail_ <= capacity) {
+                head_ = begin + size;
+                return begin % capacity;
+            }
+
+            retire(false);
+            if (inFlight_.empty()) {
+                // 空间全部被当前批次占用
+                Flush();
+            }
+            retire(true);
+        }
+    }
+
+    bool UploadManager::hasPending() const {
+        return hasPending(graphics_) || (transfer_ && hasPending(transfer_.value()));
+    }
+
+    bool UploadManager::hasPending(const Lane &lane) {
+        return !lane.buffers.empty() || !lane.images.empty();
+    }
+
+    UploadManager::ImageCopyGroup *UploadManager::findImageGroup(VkImage dst) {
+        for (auto lane: {&graphics_, transfer_ ? &transfer_.value() : nullptr}) {
+            if (!lane) {
+                continue;
+            }
+            for (auto &group: lane->images) {
+                if (group.dst == dst) {
+                    return &group;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    bool UploadManager::overlapsPending(VkBuffer dst, uint64_t offset, uint64_t size) const {
+        for (auto lane: {&graphics_, transfer_ ? &transfer_.value() : nullptr}) {
+            if (!lane) {
+                continue;
+            }
+            for (auto &group: lane->buffers) {
+                if (group.dst->buffer_ != dst) {
+                    continue;
+                }
+                for (auto &region: group.regions) {
+                    if (offset < region.dstOffset + region.size && region.dstOffset < offset + size) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    VkCommandBuffer UploadManager::acquireCmd(Lane &lane) {
+        if (!lane.freeCmds.empty()) {
+            auto cmd = lane.freeCmds.back();
+            lane.freeCmds.pop_back();
+            return cmd;
+        }
+
+        VkCommandBuffer cmd;
+        VkCommandBufferAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = lane.pool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        vkAllocateCommandBuffers(device_, &allocateInfo, &cmd);
+        return cmd;
+    }
+
+    // 传输队列的提交之后一定跟着图像队列上的 acquire，只看图像队列时间线即可
+    void UploadManager::retire(bool wait) {
+        auto &timeline = graphics_.queue.timeline;
+        while (!inFlight_.empty()) {
+            auto &submission = inFlight_.front();
+            if (wait) {
+                RENDER2D_PROFILE_SCOPE("upload wait");
+                timeline->Wait(submission.timelineValue);
+            } else if (!timeline->IsComplete(submission.timelineValue)) {
+                break;
+            }
+            wait = false;
+
+            tail_ = submission.stagingEnd;
+            completedToken_ = submission.token;
+            for (auto &[lane, cmd]: submission.cmds) {
+                lane->freeCmds.push_back(cmd);
+            }
+            inFlight_.pop_front();
+        }
+    }
+}
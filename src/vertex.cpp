@@ -3,21 +3,47 @@
 
 namespace render_2d {
     // 顶点数据具体属性，位置、颜色、法线、纹理坐标等
-    VkVertexInputAttributeDescription Vec::GetAttributeDescription() {
-        VkVertexInputAttributeDescription attributeDescription{};
-        attributeDescription.binding = 0;                      // 顶点数据在缓冲区中的 binding 绑定点
-        attributeDescription.format = VK_FORMAT_R32G32_SFLOAT; // 位置属性的数据格式
-        attributeDescription.location = 0;                     // 位置属性在 shader 里的位置
-        attributeDescription.offset = 0;                       // 位置属性在 Vertex 结构体中的偏移量 （多组顶点需要设置offset）
-        return attributeDescription;
+    std::array<VkVertexInputAttributeDescription, 5> Vec::GetAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
+        // binding 0 : 单位矩形顶点
+        attributeDescriptions[0].binding = 0;                      // 顶点数据在缓冲区中的 binding 绑定点
+        attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT; // 位置属性的数据格式
+        attributeDescriptions[0].location = 0;                     // 位置属性在 shader 里的位置
+        attributeDescriptions[0].offset = 0;                       // 位置属性在 Vertex 结构体中的偏移量 （多组顶点需要设置offset）
+
+        // binding 1 : 矩形实例的位置、大小、颜色、纹理坐标
+        attributeDescriptions[1].binding = 1;
+        attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].offset = offsetof(RectInstance, position);
+
+        attributeDescriptions[2].binding = 1;
+        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
+        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].offset = offsetof(RectInstance, size);
+
+        attributeDescriptions[3].binding = 1;
+        attributeDescriptions[3].format = VK_FORMAT_R32G32B32A32_SFLOAT; // 颜色 rgba
+        attributeDescriptions[3].location = 3;
+        attributeDescriptions[3].offset = offsetof(RectInstance, color);
+
+        attributeDescriptions[4].binding = 1;
+        attributeDescriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT; // uv 矩形
+        attributeDescriptions[4].location = 4;
+        attributeDescriptions[4].offset = offsetof(RectInstance, uvRect);
+        return attributeDescriptions;
     }
 
     // 顶点数据如何读取数据以及内存布局
-    VkVertexInputBindingDescription Vec::GetBindingDescription() {
-        VkVertexInputBindingDescription description{};
-        description.binding = 0;                             // 顶点数据在缓冲区中的 binding 绑定点
-        description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // 顶点数据按顶点为 也可以设置每个图元传输
-        description.stride = (sizeof(float) * 2);                 // 顶点数据在缓冲区中的步长
-        return description;
+    std::array<VkVertexInputBindingDescription, 2> Vec::GetBindingDescriptions() {
+        std::array<VkVertexInputBindingDescription, 2> descriptions{};
+        descriptions[0].binding = 0;                             // 顶点数据在缓冲区中的 binding 绑定点
+        descriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // 顶点数据按顶点为 也可以设置每个图元传输
+        descriptions[0].stride = (sizeof(float) * 2);            // 顶点数据在缓冲区中的步长
+
+        descriptions[1].binding = 1;
+        descriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE; // 每个实例(矩形)前进一次
+        descriptions[1].stride = sizeof(RectInstance);
+        return descriptions;
     }
 }